@@ -0,0 +1,215 @@
+// Microbenchmarks for the thread pool, built with -DEMPTYSPACE_BUILD_BENCHMARKS=ON.
+// Every case runs a few times and reports the median, followed by what each worker did
+#include "threading/jobgraph.hpp"
+#include "threading/threadpool.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <numeric>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace
+{
+    constexpr u32 kRepetitions = 7;
+
+    std::atomic<u64> g_Sink{ 0 };
+
+    f64 MedianMilliseconds(const std::function<void()>& run)
+    {
+        std::vector<f64> milliseconds;
+        for (u32 i = 0; i < kRepetitions; i++)
+        {
+            const auto begin = std::chrono::steady_clock::now();
+            run();
+            const auto end = std::chrono::steady_clock::now();
+            milliseconds.push_back(std::chrono::duration<f64, std::milli>(end - begin).count());
+        }
+
+        std::nth_element(milliseconds.begin(), milliseconds.begin() + kRepetitions / 2, milliseconds.end());
+        return milliseconds[kRepetitions / 2];
+    }
+
+    void Report(const std::string_view name, const f64 milliseconds, const u64 items, const std::string_view unit)
+    {
+        std::cout << std::left << std::setw(32) << name
+            << std::right << std::setw(10) << std::fixed << std::setprecision(3) << milliseconds << " ms"
+            << std::setw(14) << std::setprecision(1) << items / milliseconds * 1e-3 << " M" << unit << "/s\n";
+    }
+
+    // many tiny jobs from a thread outside the pool, measures the shared queue and job recycling
+    void SubmitFromOutside(ThreadPool& threadPool)
+    {
+        constexpr u32 jobCount = 100000;
+        const auto milliseconds = MedianMilliseconds([&]()
+        {
+            JobCounter counter;
+            for (u32 i = 0; i < jobCount; i++)
+            {
+                threadPool.Submit([]() { g_Sink.fetch_add(1, std::memory_order_relaxed); }, &counter);
+            }
+            threadPool.Wait(counter);
+        });
+        Report("submit from outside", milliseconds, jobCount, "jobs");
+    }
+
+    // jobs spawning jobs on the workers, measures deque push/pop and stealing
+    void SpawnTree(ThreadPool& threadPool, JobCounter& counter, const u32 depth)
+    {
+        if (depth == 0)
+        {
+            g_Sink.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+
+        threadPool.Submit([&threadPool, &counter, depth]() { SpawnTree(threadPool, counter, depth - 1); }, &counter);
+        threadPool.Submit([&threadPool, &counter, depth]() { SpawnTree(threadPool, counter, depth - 1); }, &counter);
+    }
+
+    void NestedSpawn(ThreadPool& threadPool)
+    {
+        constexpr u32 depth = 17;
+        const auto milliseconds = MedianMilliseconds([&]()
+        {
+            JobCounter counter;
+            threadPool.Submit([&]() { SpawnTree(threadPool, counter, depth); }, &counter);
+            threadPool.Wait(counter);
+        });
+        Report("nested spawn", milliseconds, (2ull << depth) - 1, "jobs");
+    }
+
+    // a job that waits on its children helps run them instead of blocking its worker
+    void WaitInsideJobs(ThreadPool& threadPool)
+    {
+        constexpr u32 parentCount = 256;
+        constexpr u32 childCount = 64;
+        const auto milliseconds = MedianMilliseconds([&]()
+        {
+            JobCounter parents;
+            for (u32 i = 0; i < parentCount; i++)
+            {
+                threadPool.Submit([&]()
+                {
+                    JobCounter children;
+                    for (u32 j = 0; j < childCount; j++)
+                    {
+                        threadPool.Submit([]() { g_Sink.fetch_add(1, std::memory_order_relaxed); }, &children);
+                    }
+                    threadPool.Wait(children);
+                }, &parents);
+            }
+            threadPool.Wait(parents);
+        });
+        Report("wait inside jobs", milliseconds, parentCount * (childCount + 1), "jobs");
+    }
+
+    void ParallelForSum(ThreadPool& threadPool)
+    {
+        constexpr u32 count = 1u << 24;
+        std::vector<f32> values(count);
+        std::iota(values.begin(), values.end(), 0.0f);
+
+        const auto serialMilliseconds = MedianMilliseconds([&]()
+        {
+            f64 sum = 0.0;
+            for (const auto value : values)
+            {
+                sum += std::sqrt(value);
+            }
+            g_Sink.fetch_add(static_cast<u64>(sum), std::memory_order_relaxed);
+        });
+        Report("sum serial", serialMilliseconds, count, "items");
+
+        const auto parallelSum = [&](const std::function<void(const std::function<void(u32, u32)>&)>& parallelFor)
+        {
+            std::vector<f64> partialSums(count / 256 + 1, 0.0);
+            parallelFor([&](const u32 begin, const u32 end)
+            {
+                f64 sum = 0.0;
+                for (auto i = begin; i < end; i++)
+                {
+                    sum += std::sqrt(values[i]);
+                }
+                partialSums[begin / 256] = sum;
+            });
+            g_Sink.fetch_add(static_cast<u64>(std::accumulate(partialSums.begin(), partialSums.end(), 0.0)), std::memory_order_relaxed);
+        };
+
+        const auto automaticMilliseconds = MedianMilliseconds([&]()
+        {
+            parallelSum([&](const std::function<void(u32, u32)>& body) { threadPool.ParallelFor(count, body); });
+        });
+        Report("sum parallel for, automatic", automaticMilliseconds, count, "items");
+
+        const auto fineMilliseconds = MedianMilliseconds([&]()
+        {
+            parallelSum([&](const std::function<void(u32, u32)>& body) { threadPool.ParallelFor(count, 256, body); });
+        });
+        Report("sum parallel for, 256 per chunk", fineMilliseconds, count, "items");
+    }
+
+    // a wide graph in the shape the scene jobs use, one job in front of many independent ones
+    void JobGraphFanOut(ThreadPool& threadPool)
+    {
+        constexpr u32 jobCount = 4096;
+        JobGraph graph;
+        const auto root = graph.Add([]() { g_Sink.fetch_add(1, std::memory_order_relaxed); });
+        for (u32 i = 0; i < jobCount; i++)
+        {
+            graph.Add([]() { g_Sink.fetch_add(1, std::memory_order_relaxed); }, { root });
+        }
+
+        const auto milliseconds = MedianMilliseconds([&]()
+        {
+            graph.Start(threadPool);
+            graph.Wait();
+        });
+        Report("job graph fan out", milliseconds, jobCount + 1, "jobs");
+    }
+}
+
+int main(const int argc, char** argv)
+{
+    auto workerCount = ThreadPool::DefaultWorkerCount();
+    auto isPinned = false;
+    for (auto i = 1; i < argc; i++)
+    {
+        const std::string_view argument = argv[i];
+        if (constexpr std::string_view workerThreadsArgument = "--worker-threads="; argument.substr(0, workerThreadsArgument.length()) == workerThreadsArgument)
+        {
+            workerCount = std::max(static_cast<u32>(std::strtoul(argv[i] + workerThreadsArgument.length(), nullptr, 10)), 1u);
+        }
+        else if (argument == "--pin-worker-threads")
+        {
+            isPinned = true;
+        }
+    }
+
+    std::cout << "Benchmarks: " << workerCount << " workers" << (isPinned ? ", pinned" : "") << ", median of " << kRepetitions << " runs\n";
+
+    ThreadPool threadPool(workerCount, isPinned);
+    SubmitFromOutside(threadPool);
+    NestedSpawn(threadPool);
+    WaitInsideJobs(threadPool);
+    ParallelForSum(threadPool);
+    JobGraphFanOut(threadPool);
+
+    std::cout << '\n' << std::setw(10) << "worker" << std::setw(14) << "executed" << std::setw(14) << "stolen"
+        << std::setw(14) << "failed steals" << std::setw(10) << "sleeps" << '\n';
+    for (u32 i = 0; i <= threadPool.WorkerCount(); i++)
+    {
+        const auto statistics = threadPool.Statistics(i);
+        std::cout << std::setw(10) << (i < threadPool.WorkerCount() ? std::to_string(i) : "other")
+            << std::setw(14) << statistics.ExecutedJobs << std::setw(14) << statistics.StolenJobs
+            << std::setw(14) << statistics.FailedSteals << std::setw(10) << statistics.Sleeps << '\n';
+    }
+
+    return 0;
+}
@@ -0,0 +1,320 @@
+// Cost of PhysicsScene::Step and of batched scene queries with asteroid fields of growing density, built with
+// -DEMPTYSPACE_BUILD_BENCHMARKS=ON. The field keeps the ring shape of the space scene, so more asteroids means
+// a denser field. The ship accelerates through it, every broadphase runs the same field.
+// The query results are checked against a hand placed scene first, the benchmarks fail if they are wrong
+#include "physics.hpp"
+#include "threading/threadpool.hpp"
+
+#include <glm/glm.hpp>
+#include <glm/gtc/constants.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace
+{
+    constexpr f32 kStepSeconds = 1.0f / 60.0f;
+    constexpr u32 kWarmupSteps = 60;
+    constexpr u32 kMeasuredSteps = 600;
+    constexpr u32 kMeasuredQueryBatches = 50;
+
+    // same distribution as SpaceScene::CreateAsteroidInstances, with a fixed seed
+    std::vector<glm::mat4> CreateAsteroidField(const u32 asteroidCount)
+    {
+        std::mt19937 random(1234);
+        std::uniform_real_distribution<f32> displacement(-100.5f, 100.5f);
+        std::uniform_real_distribution<f32> scale(2.05f, 2.65f);
+        std::uniform_real_distribution<f32> rotation(0.0f, 360.0f);
+
+        constexpr auto radius = 200.0f;
+
+        std::vector<glm::mat4> models;
+        models.reserve(asteroidCount);
+        for (u32 i = 0; i < asteroidCount; i++)
+        {
+            const auto angle = static_cast<f32>(i) / static_cast<f32>(asteroidCount) * 360.0f;
+            const auto x = std::sin(angle) * radius + displacement(random);
+            const auto y = displacement(random) * 0.4f;
+            const auto z = std::cos(angle) * radius + displacement(random);
+
+            auto model = glm::translate(glm::mat4(1.0f), glm::vec3(x, y, z));
+            model = glm::scale(model, glm::vec3(scale(random)));
+            model = glm::rotate(model, rotation(random), glm::vec3(0.4f, 0.6f, 0.8f));
+            models.push_back(model);
+        }
+
+        return models;
+    }
+
+    void MeasureStep(ThreadPool& threadPool, const physx::PxBroadPhaseType::Enum broadPhaseType, std::string_view broadPhaseName, const std::vector<glm::mat4>& field)
+    {
+        PhysicsScene physicsScene(threadPool, broadPhaseType);
+        physicsScene.SetPipelined(false);
+        physicsScene.SetFixedTimeStep(kStepSeconds, 1);
+
+        const auto setupBegin = std::chrono::steady_clock::now();
+        physicsScene.AddAsteroids(field);
+        const auto setupMilliseconds = std::chrono::duration<f64, std::milli>(std::chrono::steady_clock::now() - setupBegin).count();
+
+        // flies out of the empty centre and through the ring within the measured steps
+        physicsScene.Boost(Direction::Forward, 60.0f);
+
+        for (u32 i = 0; i < kWarmupSteps; i++)
+        {
+            physicsScene.Advance(kStepSeconds);
+        }
+
+        std::vector<f64> stepMilliseconds;
+        stepMilliseconds.reserve(kMeasuredSteps);
+        for (u32 i = 0; i < kMeasuredSteps; i++)
+        {
+            const auto begin = std::chrono::steady_clock::now();
+            physicsScene.Advance(kStepSeconds);
+            stepMilliseconds.push_back(std::chrono::duration<f64, std::milli>(std::chrono::steady_clock::now() - begin).count());
+        }
+
+        std::sort(stepMilliseconds.begin(), stepMilliseconds.end());
+        const auto percentile = [&](const f64 fraction)
+        {
+            return stepMilliseconds[static_cast<std::size_t>(fraction * static_cast<f64>(stepMilliseconds.size() - 1))];
+        };
+
+        std::cout << std::left << std::setw(6) << broadPhaseName
+            << std::right << std::setw(10) << field.size()
+            << std::setw(12) << std::fixed << std::setprecision(1) << setupMilliseconds
+            << std::setw(12) << std::setprecision(3) << percentile(0.5)
+            << std::setw(12) << percentile(0.95)
+            << std::setw(12) << stepMilliseconds.back() << '\n';
+    }
+
+    bool Check(const bool condition, const std::string_view what)
+    {
+        if (!condition)
+        {
+            std::cerr << "Check failed: " << what << '\n';
+        }
+        return condition;
+    }
+
+    bool IsNear(const f32 value, const f32 expected)
+    {
+        return std::abs(value - expected) < 1e-3f;
+    }
+
+    bool IsNear(const physx::PxVec3& value, const physx::PxVec3& expected)
+    {
+        return (value - expected).magnitude() < 1e-3f;
+    }
+
+    // Two asteroids next to the ship at the origin, boxes of half the scale on each side:
+    // one centred 50 in front (-z) with scale 2, one 50 to the right (+x) with scale 4.
+    // More rays than fit into one query job, each one pointing at a known target
+    bool CheckQueries(ThreadPool& threadPool)
+    {
+        PhysicsScene physicsScene(threadPool);
+        physicsScene.SetPipelined(false);
+        physicsScene.SetFixedTimeStep(kStepSeconds, 1);
+        physicsScene.AddAsteroids({
+            glm::scale(glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 0.0f, -50.0f)), glm::vec3(2.0f)),
+            glm::scale(glm::translate(glm::mat4(1.0f), glm::vec3(50.0f, 0.0f, 0.0f)), glm::vec3(4.0f)) });
+        physicsScene.Advance(kStepSeconds);
+
+        const auto origin = physx::PxVec3(0.0f, 0.0f, 0.0f);
+        const std::array<physx::PxVec3, 3> directions{ physx::PxVec3(0.0f, 0.0f, -1.0f), physx::PxVec3(1.0f, 0.0f, 0.0f), physx::PxVec3(0.0f, 1.0f, 0.0f) };
+        const std::array<physx::PxVec3, 2> positions{ physx::PxVec3(0.0f, 0.0f, -49.0f), physx::PxVec3(48.0f, 0.0f, 0.0f) };
+        const std::array<f32, 2> distances{ 49.0f, 48.0f };
+
+        constexpr u32 raycastCount = 100;
+        std::vector<RaycastQuery> raycasts(raycastCount);
+        for (u32 i = 0; i < raycastCount; i++)
+        {
+            raycasts[i] = { origin, directions[i % directions.size()], 100.0f };
+        }
+        const std::array<SweepQuery, 1> sweeps{ SweepQuery{ origin, 1.0f, directions[0], 100.0f } };
+        // the first sphere holds only the asteroid in front, the second both asteroids, the ship and the world anchor
+        const std::array<OverlapQuery, 2> overlaps{ OverlapQuery{ physx::PxVec3(0.0f, 0.0f, -50.0f), 5.0f }, OverlapQuery{ origin, 60.0f } };
+
+        std::vector<QueryHit> raycastHits(raycastCount);
+        std::array<QueryHit, 1> sweepHits;
+        std::array<OverlapHit, 2> overlapHits;
+
+        PhysicsQueryBatch batch;
+        batch.Raycasts = raycasts.data();
+        batch.RaycastHits = raycastHits.data();
+        batch.RaycastCount = raycastCount;
+        batch.Sweeps = sweeps.data();
+        batch.SweepHits = sweepHits.data();
+        batch.SweepCount = static_cast<u32>(sweeps.size());
+        batch.Overlaps = overlaps.data();
+        batch.OverlapHits = overlapHits.data();
+        batch.OverlapCount = static_cast<u32>(overlaps.size());
+        physicsScene.SubmitQueries(batch);
+        physicsScene.WaitForQueries();
+
+        auto isCorrect = true;
+        const auto frontAsteroid = raycastHits[0].Actor;
+        const auto rightAsteroid = raycastHits[1].Actor;
+        isCorrect &= Check(frontAsteroid != nullptr && rightAsteroid != nullptr && frontAsteroid != rightAsteroid, "raycasts hit both asteroids");
+        for (u32 i = 0; i < raycastCount; i++)
+        {
+            const auto& hit = raycastHits[i];
+            const auto target = i % directions.size();
+            if (target == 2)
+            {
+                isCorrect &= Check(!hit.IsHit && hit.Actor == nullptr, "raycast into empty space misses");
+                continue;
+            }
+
+            isCorrect &= Check(hit.IsHit && hit.Actor == (target == 0 ? frontAsteroid : rightAsteroid), "raycast result at the index of its query");
+            isCorrect &= Check(IsNear(hit.Position, positions[target]) && IsNear(hit.Distance, distances[target]), "raycast hit position and distance");
+            isCorrect &= Check(IsNear(hit.Normal, -directions[target]), "raycast hit normal");
+        }
+
+        isCorrect &= Check(sweepHits[0].IsHit && sweepHits[0].Actor == frontAsteroid, "sweep hits the asteroid in front");
+        isCorrect &= Check(IsNear(sweepHits[0].Distance, 48.0f) && IsNear(sweepHits[0].Position.z, -49.0f), "sweep stops where the sphere touches the asteroid");
+
+        isCorrect &= Check(overlapHits[0].ActorCount == 1 && overlapHits[0].Actors[0] == frontAsteroid, "overlap finds the one asteroid in it");
+        // a blocking hit would have ended the query at the first asteroid
+        isCorrect &= Check(overlapHits[1].ActorCount == 2
+            && std::find(overlapHits[1].Actors.begin(), overlapHits[1].Actors.begin() + 2, frontAsteroid) != overlapHits[1].Actors.begin() + 2
+            && std::find(overlapHits[1].Actors.begin(), overlapHits[1].Actors.begin() + 2, rightAsteroid) != overlapHits[1].Actors.begin() + 2,
+            "overlap reports every asteroid as a touch and leaves out the ship and the world anchor");
+
+        // the ship is a sphere of radius 1 at the origin, a ray coming from behind ends on it once it is included
+        const std::array<RaycastQuery, 1> shipRaycasts{ RaycastQuery{ physx::PxVec3(0.0f, 0.0f, 10.0f), directions[0], 100.0f } };
+        std::array<QueryHit, 1> shipRaycastHits;
+        PhysicsQueryBatch shipBatch;
+        shipBatch.Raycasts = shipRaycasts.data();
+        shipBatch.RaycastHits = shipRaycastHits.data();
+        shipBatch.RaycastCount = 1;
+        shipBatch.IncludesShip = true;
+        physicsScene.SubmitQueries(shipBatch);
+        physicsScene.WaitForQueries();
+        isCorrect &= Check(shipRaycastHits[0].IsHit && shipRaycastHits[0].Actor == physicsScene.Camera && IsNear(shipRaycastHits[0].Distance, 9.0f), "raycast including the ship hits it");
+
+        return isCorrect;
+    }
+
+    // what a few hundred agents ask for in a frame: a targeting ray, a look ahead sweep and a proximity sensor each
+    void MeasureQueries(ThreadPool& threadPool, const std::vector<glm::mat4>& field)
+    {
+        constexpr u32 agentCount = 512;
+
+        PhysicsScene physicsScene(threadPool);
+        physicsScene.SetPipelined(false);
+        physicsScene.SetFixedTimeStep(kStepSeconds, 1);
+        physicsScene.AddAsteroids(field);
+        physicsScene.Advance(kStepSeconds);
+
+        std::mt19937 random(5678);
+        std::uniform_real_distribution<f32> angle(0.0f, glm::two_pi<f32>());
+        std::uniform_real_distribution<f32> unit(-1.0f, 1.0f);
+
+        std::vector<RaycastQuery> raycasts(agentCount);
+        std::vector<SweepQuery> sweeps(agentCount);
+        std::vector<OverlapQuery> overlaps(agentCount);
+        for (u32 i = 0; i < agentCount; i++)
+        {
+            const auto agentAngle = angle(random);
+            const auto origin = physx::PxVec3(std::sin(agentAngle) * 200.0f, unit(random) * 40.0f, std::cos(agentAngle) * 200.0f);
+            const auto direction = physx::PxVec3(unit(random), unit(random) * 0.2f, unit(random)).getNormalized();
+
+            raycasts[i] = { origin, direction, 500.0f };
+            sweeps[i] = { origin, 1.0f, direction, 50.0f };
+            overlaps[i] = { origin, 25.0f };
+        }
+
+        std::vector<QueryHit> raycastHits(agentCount);
+        std::vector<QueryHit> sweepHits(agentCount);
+        std::vector<OverlapHit> overlapHits(agentCount);
+
+        PhysicsQueryBatch batch;
+        batch.Raycasts = raycasts.data();
+        batch.RaycastHits = raycastHits.data();
+        batch.RaycastCount = agentCount;
+        batch.Sweeps = sweeps.data();
+        batch.SweepHits = sweepHits.data();
+        batch.SweepCount = agentCount;
+        batch.Overlaps = overlaps.data();
+        batch.OverlapHits = overlapHits.data();
+        batch.OverlapCount = agentCount;
+
+        std::vector<f64> batchMilliseconds;
+        for (u32 i = 0; i < kMeasuredQueryBatches; i++)
+        {
+            const auto begin = std::chrono::steady_clock::now();
+            physicsScene.SubmitQueries(batch);
+            physicsScene.WaitForQueries();
+            batchMilliseconds.push_back(std::chrono::duration<f64, std::milli>(std::chrono::steady_clock::now() - begin).count());
+        }
+        std::sort(batchMilliseconds.begin(), batchMilliseconds.end());
+
+        const auto raycastHitCount = std::count_if(raycastHits.begin(), raycastHits.end(), [](const QueryHit& hit) { return hit.IsHit; });
+        const auto sweepHitCount = std::count_if(sweepHits.begin(), sweepHits.end(), [](const QueryHit& hit) { return hit.IsHit; });
+        const auto overlapHitCount = std::count_if(overlapHits.begin(), overlapHits.end(), [](const OverlapHit& hit) { return hit.ActorCount != 0; });
+
+        std::cout << std::setw(10) << field.size() << std::setw(10) << agentCount * 3
+            << std::setw(12) << std::fixed << std::setprecision(3) << batchMilliseconds[batchMilliseconds.size() / 2]
+            << std::setw(12) << batchMilliseconds.back()
+            << std::setw(8) << raycastHitCount << std::setw(8) << sweepHitCount << std::setw(8) << overlapHitCount << '\n';
+    }
+}
+
+int main(const int argc, char** argv)
+{
+    auto workerCount = ThreadPool::DefaultWorkerCount();
+    for (auto i = 1; i < argc; i++)
+    {
+        const std::string_view argument = argv[i];
+        if (constexpr std::string_view workerThreadsArgument = "--worker-threads="; argument.substr(0, workerThreadsArgument.length()) == workerThreadsArgument)
+        {
+            workerCount = std::max(static_cast<u32>(std::strtoul(argv[i] + workerThreadsArgument.length(), nullptr, 10)), 1u);
+        }
+    }
+
+    ThreadPool threadPool(workerCount);
+    if (!CheckQueries(threadPool))
+    {
+        return 1;
+    }
+
+    constexpr std::array<u32, 3> asteroidCounts{ 5000, 50000, 200000 };
+    constexpr std::array<std::pair<physx::PxBroadPhaseType::Enum, std::string_view>, 3> broadPhases
+    {
+        std::pair{ physx::PxBroadPhaseType::eSAP, std::string_view("SAP") },
+        std::pair{ physx::PxBroadPhaseType::eMBP, std::string_view("MBP") },
+        std::pair{ physx::PxBroadPhaseType::eABP, std::string_view("ABP") },
+    };
+
+    std::cout << "Benchmarks: " << workerCount << " workers, " << kMeasuredSteps << " steps of " << kStepSeconds * 1000.0f << "ms\n";
+    std::cout << std::left << std::setw(6) << "bp" << std::right << std::setw(10) << "asteroids" << std::setw(12) << "setup ms"
+        << std::setw(12) << "step p50" << std::setw(12) << "step p95" << std::setw(12) << "step max" << '\n';
+
+    for (const auto asteroidCount : asteroidCounts)
+    {
+        const auto field = CreateAsteroidField(asteroidCount);
+        for (const auto& [broadPhaseType, broadPhaseName] : broadPhases)
+        {
+            MeasureStep(threadPool, broadPhaseType, broadPhaseName, field);
+        }
+    }
+
+    std::cout << '\n' << std::setw(10) << "asteroids" << std::setw(10) << "queries" << std::setw(12) << "batch p50"
+        << std::setw(12) << "batch max" << std::setw(8) << "rays" << std::setw(8) << "sweeps" << std::setw(8) << "near" << '\n';
+    for (const auto asteroidCount : asteroidCounts)
+    {
+        MeasureQueries(threadPool, CreateAsteroidField(asteroidCount));
+    }
+
+    return 0;
+}
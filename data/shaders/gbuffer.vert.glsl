@@ -19,37 +19,52 @@ layout(location = 6) out smooth vec4 fs_current_position;
 layout(location = 7) out smooth vec4 fs_previous_position;
 layout(location = 8) out flat mat4 fs_model_matrix;
 
-layout(location = 0) uniform mat4 u_projection;
-layout(location = 1) uniform mat4 u_view;
-layout(location = 2) uniform mat4 u_model;
+#include "include/framedata.glsl"
+
+// IS_INSTANCED and EXCLUDE_FROM_MOTIONBLUR are permutation features, defined as 0 or 1 by Program
+#if IS_INSTANCED
 layout(location = 3) uniform mat4 u_model_view_projection_current;
 layout(location = 4) uniform mat4 u_model_view_projection_previous;
-layout(location = 5) uniform bool u_exclude_from_motionblur;
-layout(location = 6) uniform bool u_is_instanced;
+#else
+layout(location = 8) uniform int u_batch_offset;
+#endif
 
 layout(std430, binding = 0) buffer instanceBuffer
 {
     mat4 b_world_matrices[];
 };
 
+#if IS_INSTANCED
+layout(std430, binding = 1) readonly buffer visibleInstanceBuffer
+{
+    uint b_visible_instances[];
+};
+#else
+layout(std430, binding = 2) readonly buffer previousMatrixBuffer
+{
+    mat4 b_model_view_projection_previous[];
+};
+#endif
+
 void main()
 {
-    if (u_exclude_from_motionblur)
-    {
-        fs_current_position = u_model_view_projection_current * vec4(i_position, 1.0);
-        fs_previous_position = fs_current_position;
-    }
-    else
-    {
-        fs_current_position = u_model_view_projection_current * vec4(i_position, 1.0);
-        fs_previous_position = u_model_view_projection_previous * vec4(i_position, 1.0);
-    }
-
-    mat4 v_model_matrix = u_model;
-    if (u_is_instanced)
-    {
-       v_model_matrix = b_world_matrices[gl_InstanceID];
-    }
+#if IS_INSTANCED
+    const mat4 v_model_matrix = b_world_matrices[b_visible_instances[gl_InstanceID]];
+    const mat4 v_model_view_projection_current = u_model_view_projection_current;
+    const mat4 v_model_view_projection_previous = u_model_view_projection_previous;
+#else
+    const int instanceIndex = u_batch_offset + gl_InstanceID;
+    const mat4 v_model_matrix = b_world_matrices[instanceIndex];
+    const mat4 v_model_view_projection_current = u_view_projection * v_model_matrix;
+    const mat4 v_model_view_projection_previous = b_model_view_projection_previous[instanceIndex];
+#endif
+
+    fs_current_position = v_model_view_projection_current * vec4(i_position, 1.0);
+#if EXCLUDE_FROM_MOTIONBLUR
+    fs_previous_position = fs_current_position;
+#else
+    fs_previous_position = v_model_view_projection_previous * vec4(i_position, 1.0);
+#endif
 
     const vec4 mpos = (u_view * v_model_matrix * vec4(i_position, 1.0));
     gl_Position = u_projection * mpos;
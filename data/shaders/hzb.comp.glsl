@@ -0,0 +1,48 @@
+#version 450
+
+layout(local_size_x = 8, local_size_y = 8) in;
+
+layout(binding = 0) uniform sampler2D t_depth;
+
+layout(binding = 0, r32f) uniform readonly image2D i_source;
+layout(binding = 1, r32f) uniform writeonly image2D i_destination;
+
+layout(location = 0) uniform int u_level;
+layout(location = 1) uniform ivec2 u_destination_size;
+// part of the depth texture that was rendered to, dynamic resolution renders into its top left
+layout(location = 2) uniform ivec2 u_depth_size;
+
+void main()
+{
+    const ivec2 texel = ivec2(gl_GlobalInvocationID.xy);
+    if (any(greaterThanEqual(texel, u_destination_size)))
+    {
+        return;
+    }
+
+    float maxDepth = 0.0;
+    if (u_level == 0)
+    {
+        // the first level is a power of two smaller than the depth buffer, gather its whole footprint
+        const ivec2 depthSize = u_depth_size;
+        const ivec2 begin = (texel * depthSize) / u_destination_size;
+        const ivec2 end = min(((texel + 1) * depthSize + u_destination_size - 1) / u_destination_size, depthSize);
+        for (int y = begin.y; y < end.y; ++y)
+        {
+            for (int x = begin.x; x < end.x; ++x)
+            {
+                maxDepth = max(maxDepth, texelFetch(t_depth, ivec2(x, y), 0).r);
+            }
+        }
+    }
+    else
+    {
+        // out of bounds loads return zero and therefore never win
+        const ivec2 sourceTexel = texel * 2;
+        maxDepth = max(
+            max(imageLoad(i_source, sourceTexel).r, imageLoad(i_source, sourceTexel + ivec2(1, 0)).r),
+            max(imageLoad(i_source, sourceTexel + ivec2(0, 1)).r, imageLoad(i_source, sourceTexel + ivec2(1, 1)).r));
+    }
+
+    imageStore(i_destination, texel, vec4(maxDepth));
+}
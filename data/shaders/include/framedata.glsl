@@ -0,0 +1,9 @@
+// per frame uniforms, std140 mirror of FrameUniforms in main.cpp
+layout(std140, binding = 0) uniform FrameData
+{
+    mat4 u_projection;
+    mat4 u_view;
+    mat4 u_view_projection;
+    mat4 u_view_projection_previous;
+    vec4 u_camera_position;
+};
@@ -0,0 +1,16 @@
+// visible lights of the frame, std430 mirror of LightData in light.hpp
+struct LightData
+{
+    mat4 Model;
+    vec4 Position;
+    vec4 Color;
+    vec4 Direction;
+    vec4 Attenuation;
+    vec4 CutOff;
+    ivec4 Type;
+};
+
+layout(std430, binding = 3) readonly buffer lightBuffer
+{
+    LightData b_lights[];
+};
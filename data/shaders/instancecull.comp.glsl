@@ -0,0 +1,109 @@
+#version 450
+
+layout(local_size_x = 64) in;
+
+struct DrawElementsIndirectCommand
+{
+    uint Count;
+    uint InstanceCount;
+    uint FirstIndex;
+    int BaseVertex;
+    uint BaseInstance;
+};
+
+layout(std430, binding = 0) readonly buffer instanceBuffer
+{
+    mat4 b_world_matrices[];
+};
+
+layout(std430, binding = 1) writeonly buffer visibleInstanceBuffer
+{
+    uint b_visible_instances[];
+};
+
+layout(std430, binding = 2) buffer drawCommandBuffer
+{
+    DrawElementsIndirectCommand b_draw_command;
+};
+
+layout(location = 0) uniform vec4 u_frustum_planes[6];
+layout(location = 6) uniform vec3 u_camera_position;
+layout(location = 7) uniform float u_max_distance;
+layout(location = 8) uniform uint u_instance_count;
+layout(location = 9) uniform float u_bounding_radius;
+layout(location = 10) uniform bool u_is_occlusion_culling_enabled;
+layout(location = 11) uniform mat4 u_hzb_view_projection;
+layout(location = 12) uniform vec2 u_hzb_size;
+layout(location = 13) uniform int u_hzb_level_count;
+
+layout(binding = 0) uniform sampler2D t_hzb;
+
+bool IsOccluded(vec3 center, float radius)
+{
+    vec2 minUv = vec2(1.0);
+    vec2 maxUv = vec2(0.0);
+    float minDepth = 1.0;
+    for (int corner = 0; corner < 8; ++corner)
+    {
+        const vec3 offset = vec3((corner & 1) != 0 ? radius : -radius, (corner & 2) != 0 ? radius : -radius, (corner & 4) != 0 ? radius : -radius);
+        const vec4 clipPosition = u_hzb_view_projection * vec4(center + offset, 1.0);
+        if (clipPosition.w <= 0.0)
+        {
+            return false;
+        }
+
+        const vec3 ndc = clipPosition.xyz / clipPosition.w;
+        minUv = min(minUv, ndc.xy * 0.5 + 0.5);
+        maxUv = max(maxUv, ndc.xy * 0.5 + 0.5);
+        minDepth = min(minDepth, ndc.z * 0.5 + 0.5);
+    }
+
+    minUv = clamp(minUv, vec2(0.0), vec2(1.0));
+    maxUv = clamp(maxUv, vec2(0.0), vec2(1.0));
+
+    // pick the level at which the screen rectangle covers at most 2x2 texels
+    const vec2 extent = (maxUv - minUv) * u_hzb_size;
+    const float level = clamp(ceil(log2(max(max(extent.x, extent.y), 1.0))), 0.0, float(u_hzb_level_count - 1));
+
+    const float maxDepth = max(
+        max(textureLod(t_hzb, minUv, level).r, textureLod(t_hzb, vec2(maxUv.x, minUv.y), level).r),
+        max(textureLod(t_hzb, vec2(minUv.x, maxUv.y), level).r, textureLod(t_hzb, maxUv, level).r));
+
+    return minDepth > maxDepth;
+}
+
+void main()
+{
+    const uint instanceIndex = gl_GlobalInvocationID.x;
+    if (instanceIndex >= u_instance_count)
+    {
+        return;
+    }
+
+    const mat4 worldMatrix = b_world_matrices[instanceIndex];
+    const vec3 center = worldMatrix[3].xyz;
+    const float scale = max(length(worldMatrix[0].xyz), max(length(worldMatrix[1].xyz), length(worldMatrix[2].xyz)));
+    const float radius = u_bounding_radius * scale;
+
+    // max distance of zero disables distance culling
+    if (u_max_distance > 0.0 && distance(center, u_camera_position) - radius > u_max_distance)
+    {
+        return;
+    }
+
+    for (int i = 0; i < 6; ++i)
+    {
+        if (dot(u_frustum_planes[i].xyz, center) + u_frustum_planes[i].w <= -radius)
+        {
+            return;
+        }
+    }
+
+    if (u_is_occlusion_culling_enabled && IsOccluded(center, radius))
+    {
+        return;
+    }
+
+    const uint visibleIndex = atomicAdd(b_draw_command.InstanceCount, 1u);
+    b_visible_instances[visibleIndex] = instanceIndex;
+}
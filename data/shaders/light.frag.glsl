@@ -1,6 +1,7 @@
 #version 450
 
 layout(location = 1) in vec2 fs_uv;
+layout(location = 2) in flat int fs_light_index;
 
 layout(location = 0) out vec4 out_color;
 
@@ -9,13 +10,9 @@ layout(binding = 1) uniform sampler2D t_gbuffer_normal;
 layout(binding = 2) uniform sampler2D t_gbuffer_depth;
 layout(binding = 3) uniform sampler2D t_gbuffer_specular;
 
-layout(location = 0) uniform int u_light_type;
-layout(location = 1) uniform vec3 u_light_position;
-layout(location = 2) uniform vec3 u_light_color;
-layout(location = 3) uniform vec3 u_light_direction;
-layout(location = 4) uniform vec3 u_light_attenuation;
-layout(location = 5) uniform vec2 u_light_cutoff;
-layout(location = 6) uniform vec3 u_camera_position;
+#include "include/framedata.glsl"
+
+#include "include/lightdata.glsl"
 
 float CalculateDiffuse_Lambert(vec3 fragmentPosition, vec3 normal, vec3 lightPosition)
 {
@@ -58,24 +55,26 @@ void main()
     vec3 ambientLight = vec3(0.0f);
     vec3 specularLight = vec3(0.0f);
 
-    const vec3 lightPosition = u_light_position.xyz;
-    const vec3 lightColor = u_light_color.rgb;
-    const vec3 lightAttenuation = u_light_attenuation;
+    const LightData v_light = b_lights[fs_light_index];
+    const vec3 lightPosition = v_light.Position.xyz;
+    const vec3 lightColor = v_light.Color.rgb;
+    const vec3 lightAttenuation = v_light.Attenuation.xyz;
 
-    if (u_light_type == 1)
+    // IS_SPOT_LIGHT is a permutation feature, lights are drawn in one batch per type
+#if IS_SPOT_LIGHT
     {
         float attenuation = CalculateAttenuation(position, lightPosition, lightAttenuation.z);
         
         diffuseLight += attenuation * CalculateDiffuse_Lambert(position, normal, lightPosition) * lightColor;
-        specularLight += attenuation * CalculateSpecular_BlinnPhong(position, normal, lightPosition, u_camera_position, 8);
+        specularLight += attenuation * CalculateSpecular_BlinnPhong(position, normal, lightPosition, u_camera_position.xyz, 8);
 
         finalLight = (ambientLight + diffuseLight + (specularLight));
     }
-    else
+#else
     {
-        const vec3 lightDirection = u_light_direction;
-        const float lightCutOffInner = u_light_cutoff.x;
-        const float lightCutOffOuter = u_light_cutoff.y;
+        const vec3 lightDirection = v_light.Direction.xyz;
+        const float lightCutOffInner = v_light.CutOff.x;
+        const float lightCutOffOuter = v_light.CutOff.y;
 
         vec3 lightDir = normalize(lightPosition - position);
 
@@ -84,7 +83,7 @@ void main()
 
         // specular shading
         vec3 reflectDir = reflect(-lightDir, normal);
-        vec3 viewDir = normalize(u_camera_position - lightPosition);
+        vec3 viewDir = normalize(u_camera_position.xyz - lightPosition);
         float spec = pow(max(dot(viewDir, reflectDir), 0.0), 8.0);
         spec = v_specular + (0.00001 * spec);
 
@@ -111,6 +110,7 @@ void main()
 
 //		return (ambientLight + diffuseLight + specularLight);
     }
+#endif
 
     out_color = vec4(finalLight, 1.0);
 }
\ No newline at end of file
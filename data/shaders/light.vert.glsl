@@ -7,13 +7,15 @@ layout(location = 0) out gl_PerVertex
     vec4 gl_Position;
 };
 layout(location = 1) out vec2 fs_uv;
+layout(location = 2) out flat int fs_light_index;
 
-layout(location = 0) uniform mat4 u_projection;
-layout(location = 1) uniform mat4 u_view;
-layout(location = 2) uniform mat4 u_model;
+#include "include/framedata.glsl"
+
+#include "include/lightdata.glsl"
 
 void main()
 {
-    const vec4 mpos = (u_projection * u_view * u_model * vec4(in_position, 1.0));
+    const vec4 mpos = (u_view_projection * b_lights[gl_InstanceID].Model * vec4(in_position, 1.0));
     gl_Position = mpos;
+    fs_light_index = gl_InstanceID;
 }
\ No newline at end of file
@@ -6,25 +6,102 @@ layout (location = 0) out vec4 out_color;
 
 layout (binding = 0) uniform sampler2D t_color;
 layout (binding = 1) uniform sampler2D t_velocity;
+layout (binding = 2) uniform sampler2D t_depth;
+layout (binding = 3) uniform sampler2D t_neighbor_max;
+
+#include "include/framedata.glsl"
 
 layout (location = 0) uniform float u_velocity_scale;
+// full resolution pixels per output pixel, 2 when blurring at half resolution
+layout (location = 1) uniform int u_resolution_scale;
+layout (location = 2) uniform float u_max_velocity;
+layout (location = 3) uniform vec2 u_uv_diff;
+
+// must match MotionBlurTiles::TileSize
+const int kTileSize = 16;
+const int kMaxSamples = 32;
+// view space distance over which two surfaces blend from in front to behind
+const float kSoftDepthExtent = 0.5;
+
+float LinearDepth(ivec2 texel)
+{
+    float ndcDepth = texelFetch(t_depth, texel, 0).r * 2.0 - 1.0;
+    return u_projection[3][2] / (ndcDepth + u_projection[2][2]);
+}
+
+vec2 Velocity(ivec2 texel, vec2 renderSize)
+{
+    vec2 velocity = texelFetch(t_velocity, texel, 0).rg * u_velocity_scale * renderSize;
+    float speed = length(velocity);
+    return speed > u_max_velocity ? velocity * (u_max_velocity / speed) : velocity;
+}
+
+float SoftDepthCompare(float a, float b)
+{
+    return clamp(1.0 - (a - b) / kSoftDepthExtent, 0.0, 1.0);
+}
+
+float Cone(float distance, float speed)
+{
+    return clamp(1.0 - distance / speed, 0.0, 1.0);
+}
+
+float Cylinder(float distance, float speed)
+{
+    return 1.0 - smoothstep(0.95 * speed, 1.05 * speed, distance);
+}
 
 void main()
 {
-    vec2 v_texel_size = 1.0 / vec2(textureSize(t_color, 0));
-    vec2 v_uv = gl_FragCoord.xy * v_texel_size;
-    vec2 v_velocity = texture(t_velocity, v_uv).rg * u_velocity_scale;
+    // the velocity texture covers the whole render target, the rendered part starts at its origin
+    vec2 v_render_size = u_uv_diff * vec2(textureSize(t_velocity, 0));
+    ivec2 v_max_texel = ivec2(v_render_size) - 1;
+    ivec2 v_texel = min(ivec2(gl_FragCoord.xy) * u_resolution_scale, v_max_texel);
+
+    vec4 v_center_color = texelFetch(t_color, v_texel, 0);
+    vec2 v_neighbor_max = texelFetch(t_neighbor_max, v_texel / kTileSize, 0).rg;
+    float v_neighbor_speed = length(v_neighbor_max);
+
+    // nothing around this pixel moves far enough to show, which is most of the screen most of the time
+    if (v_neighbor_speed < 0.5 * float(u_resolution_scale))
+    {
+        out_color = v_center_color;
+        return;
+    }
 
-    float v_speed = length(v_velocity / v_texel_size);
-    int v_samples = clamp(int(v_speed), 1, 32);
+    float v_center_depth = LinearDepth(v_texel);
+    float v_center_speed = max(length(Velocity(v_texel, v_render_size)), 0.5);
 
-    out_color = texture(t_color, fs_uv);
+    // a sample every other pixel along the neighborhood velocity is enough with the jitter below
+    int v_samples = clamp(int(ceil(v_neighbor_speed * 0.5 / float(u_resolution_scale))), 3, kMaxSamples);
+    float v_jitter = fract(52.9829189 * fract(dot(gl_FragCoord.xy, vec2(0.06711056, 0.00583715)))) - 0.5;
 
-    for (int i = 1; i < v_samples; ++i)
+    float v_weight_sum = 1.0 / v_center_speed;
+    vec4 v_color_sum = v_center_color * v_weight_sum;
+
+    for (int i = 0; i < v_samples; ++i)
     {
-        vec2 v_offset = v_velocity * (float(i) / float(v_samples - 1) - 0.5);
-        out_color += texture(t_color, v_uv + v_offset);
+        // spread over the velocity centered on the pixel, like the exposure it approximates
+        float t = mix(-1.0, 1.0, (float(i) + v_jitter + 1.0) / float(v_samples + 1));
+        vec2 v_offset = v_neighbor_max * (0.5 * t);
+        ivec2 v_sample_texel = clamp(ivec2(vec2(v_texel) + 0.5 + v_offset), ivec2(0), v_max_texel);
+
+        float v_distance = length(v_offset);
+        float v_sample_depth = LinearDepth(v_sample_texel);
+        float v_sample_speed = max(length(Velocity(v_sample_texel, v_render_size)), 0.5);
+
+        float v_foreground = SoftDepthCompare(v_sample_depth, v_center_depth);
+        float v_background = SoftDepthCompare(v_center_depth, v_sample_depth);
+
+        // the sample blurs over this pixel, or this pixel blurs over the sample, or both move together
+        float v_weight =
+            v_foreground * Cone(v_distance, v_sample_speed) +
+            v_background * Cone(v_distance, v_center_speed) +
+            Cylinder(v_distance, v_sample_speed) * Cylinder(v_distance, v_center_speed) * 2.0;
+
+        v_weight_sum += v_weight;
+        v_color_sum += texelFetch(t_color, v_sample_texel, 0) * v_weight;
     }
 
-    out_color /= float(v_samples);
-}
\ No newline at end of file
+    out_color = v_color_sum / v_weight_sum;
+}
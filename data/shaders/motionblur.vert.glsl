@@ -12,5 +12,5 @@ layout(location = 3) uniform vec2 u_uv_diff;
 void main()
 {
     gl_Position = vec4(float(gl_VertexID / 2) * 4.0 - 1.0, float(gl_VertexID % 2) * 4.0 - 1.0, 0.0, 1.0);
-    fs_uv = vec2(float(gl_VertexID / 2) * 2.0, float(gl_VertexID % 2) * 2.0);
+    fs_uv = vec2(float(gl_VertexID / 2) * 2.0, float(gl_VertexID % 2) * 2.0) * u_uv_diff;
 }
\ No newline at end of file
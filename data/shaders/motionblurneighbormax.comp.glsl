@@ -0,0 +1,34 @@
+#version 450
+
+layout(local_size_x = 8, local_size_y = 8) in;
+
+layout(binding = 0, rg16f) uniform readonly image2D i_tile_max;
+layout(binding = 1, rg16f) uniform writeonly image2D i_neighbor_max;
+
+layout(location = 0) uniform ivec2 u_tile_count;
+
+void main()
+{
+    const ivec2 tile = ivec2(gl_GlobalInvocationID.xy);
+    if (any(greaterThanEqual(tile, u_tile_count)))
+    {
+        return;
+    }
+
+    // a pixel can be covered by anything moving in the surrounding tiles
+    vec2 neighborMax = vec2(0.0);
+    for (int y = -1; y <= 1; ++y)
+    {
+        for (int x = -1; x <= 1; ++x)
+        {
+            const ivec2 neighbor = clamp(tile + ivec2(x, y), ivec2(0), u_tile_count - 1);
+            const vec2 velocity = imageLoad(i_tile_max, neighbor).rg;
+            if (dot(velocity, velocity) > dot(neighborMax, neighborMax))
+            {
+                neighborMax = velocity;
+            }
+        }
+    }
+
+    imageStore(i_neighbor_max, tile, vec4(neighborMax, 0.0, 0.0));
+}
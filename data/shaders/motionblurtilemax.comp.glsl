@@ -0,0 +1,54 @@
+#version 450
+
+// one work group per tile, must match MotionBlurTiles::TileSize
+layout(local_size_x = 16, local_size_y = 16) in;
+
+layout(binding = 0) uniform sampler2D t_velocity;
+
+layout(binding = 0, rg16f) uniform writeonly image2D i_tile_max;
+
+layout(location = 0) uniform float u_velocity_scale;
+// part of the velocity texture that was rendered to
+layout(location = 1) uniform ivec2 u_render_size;
+// longest velocity in pixels, the neighborhood of a tile only reaches that far
+layout(location = 2) uniform float u_max_velocity;
+
+shared vec2 s_velocity[gl_WorkGroupSize.x * gl_WorkGroupSize.y];
+
+void main()
+{
+    const ivec2 texel = ivec2(gl_GlobalInvocationID.xy);
+    const uint index = gl_LocalInvocationIndex;
+
+    vec2 velocity = vec2(0.0);
+    if (all(lessThan(texel, u_render_size)))
+    {
+        // velocities are stored in uvs of the rendered rectangle, the tiles work in pixels
+        velocity = texelFetch(t_velocity, texel, 0).rg * u_velocity_scale * vec2(u_render_size);
+        float speed = length(velocity);
+        if (speed > u_max_velocity)
+        {
+            velocity *= u_max_velocity / speed;
+        }
+    }
+    s_velocity[index] = velocity;
+    barrier();
+
+    for (uint stride = (gl_WorkGroupSize.x * gl_WorkGroupSize.y) / 2; stride > 0; stride /= 2)
+    {
+        if (index < stride)
+        {
+            vec2 other = s_velocity[index + stride];
+            if (dot(other, other) > dot(s_velocity[index], s_velocity[index]))
+            {
+                s_velocity[index] = other;
+            }
+        }
+        barrier();
+    }
+
+    if (index == 0)
+    {
+        imageStore(i_tile_max, ivec2(gl_WorkGroupID.xy), vec4(s_velocity[0], 0.0, 0.0));
+    }
+}
@@ -0,0 +1,63 @@
+#version 450
+
+layout (location = 1) in vec2 fs_uv;
+
+layout (location = 0) out vec4 out_color;
+
+layout (binding = 0) uniform sampler2D t_color;
+layout (binding = 1) uniform sampler2D t_blurred;
+layout (binding = 2) uniform sampler2D t_depth;
+layout (binding = 3) uniform sampler2D t_neighbor_max;
+
+#include "include/framedata.glsl"
+
+layout (location = 3) uniform vec2 u_uv_diff;
+
+// must match MotionBlurTiles::TileSize
+const int kTileSize = 16;
+
+float LinearDepth(ivec2 texel)
+{
+    float ndcDepth = texelFetch(t_depth, texel, 0).r * 2.0 - 1.0;
+    return u_projection[3][2] / (ndcDepth + u_projection[2][2]);
+}
+
+void main()
+{
+    vec2 v_render_size = u_uv_diff * vec2(textureSize(t_color, 0));
+    ivec2 v_texel = ivec2(gl_FragCoord.xy);
+
+    // static neighborhoods were passed through at half resolution, keep them sharp
+    vec2 v_neighbor_max = texelFetch(t_neighbor_max, v_texel / kTileSize, 0).rg;
+    if (dot(v_neighbor_max, v_neighbor_max) < 1.0)
+    {
+        out_color = texelFetch(t_color, v_texel, 0);
+        return;
+    }
+
+    // bilinear weights, lowered for half resolution texels whose depth differs from this pixel,
+    // each half resolution texel was blurred around the top left full resolution pixel of its block
+    ivec2 v_half_max_texel = (ivec2(v_render_size) - 1) / 2;
+    vec2 v_half_position = vec2(v_texel) * 0.5;
+    ivec2 v_half_base = ivec2(floor(v_half_position));
+    vec2 v_fraction = v_half_position - vec2(v_half_base);
+
+    float v_depth = LinearDepth(v_texel);
+    vec4 v_color_sum = vec4(0.0);
+    float v_weight_sum = 0.0;
+    for (int y = 0; y <= 1; ++y)
+    {
+        for (int x = 0; x <= 1; ++x)
+        {
+            ivec2 v_half_texel = clamp(v_half_base + ivec2(x, y), ivec2(0), v_half_max_texel);
+            float v_bilinear = (x == 0 ? 1.0 - v_fraction.x : v_fraction.x) * (y == 0 ? 1.0 - v_fraction.y : v_fraction.y);
+            float v_sample_depth = LinearDepth(v_half_texel * 2);
+            float v_weight = v_bilinear / (1e-3 + abs(v_depth - v_sample_depth) / v_depth);
+
+            v_color_sum += texelFetch(t_blurred, v_half_texel, 0) * v_weight;
+            v_weight_sum += v_weight;
+        }
+    }
+
+    out_color = v_color_sum / max(v_weight_sum, 1e-6);
+}
@@ -0,0 +1,50 @@
+#version 450
+
+layout(local_size_x = 8, local_size_y = 8) in;
+
+layout(binding = 0) uniform sampler2D t_lights;
+layout(binding = 1) uniform sampler2D t_albedo;
+layout(binding = 2) uniform sampler2D t_depth;
+layout(binding = 3) uniform samplerCube tc_skybox;
+
+layout(binding = 0, rgba8) uniform writeonly image2D i_final;
+
+layout(location = 0) uniform mat3 u_camera_direction;
+layout(location = 1) uniform float u_fov;
+layout(location = 2) uniform float u_ratio;
+// part of the targets that was rendered to, dynamic resolution renders into their top left
+layout(location = 3) uniform ivec2 u_render_size;
+// rgb is blended over the image by w, w is zero outside of transitions
+layout(location = 4) uniform vec4 u_blend_color;
+
+vec3 skyray(vec2 texcoord, float fovy, float aspect)
+{
+    float d = 0.5 / tan(fovy / 2.0);
+    return normalize(vec3((texcoord.x - 0.5) * aspect, texcoord.y - 0.5, -d));
+}
+
+void main()
+{
+    const ivec2 texel = ivec2(gl_GlobalInvocationID.xy);
+    if (any(greaterThanEqual(texel, u_render_size)))
+    {
+        return;
+    }
+
+    // resolve, the same as main.frag
+    vec3 color;
+    if (texelFetch(t_depth, texel, 0).r == 1.0)
+    {
+        const vec2 uv = (vec2(texel) + 0.5) / vec2(u_render_size);
+        color = textureLod(tc_skybox, u_camera_direction * skyray(uv, u_fov, u_ratio), 0.0).rgb;
+    }
+    else
+    {
+        color = texelFetch(t_lights, texel, 0).rgb * texelFetch(t_albedo, texel, 0).rgb;
+    }
+
+    // transition, the same as quad.frag
+    color = mix(color, u_blend_color.rgb, u_blend_color.w);
+
+    imageStore(i_final, texel, vec4(color, 1.0));
+}
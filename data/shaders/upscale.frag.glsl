@@ -0,0 +1,29 @@
+#version 450
+
+layout(location = 1) in vec2 fs_uv;
+
+layout(location = 0) out vec4 out_color;
+
+// sampled with a linear filtering sampler, the targets themselves filter nearest
+layout(binding = 0) uniform sampler2D t_source;
+
+layout(location = 0) uniform float u_sharpness;
+layout(location = 3) uniform vec2 u_uv_diff;
+
+void main()
+{
+    const vec2 v_texel_size = 1.0 / vec2(textureSize(t_source, 0));
+    // keep the neighbour taps inside the rendered sub rectangle
+    const vec2 v_uv_max = u_uv_diff - 0.5 * v_texel_size;
+
+    const vec3 v_center = texture(t_source, min(fs_uv, v_uv_max)).rgb;
+    const vec3 v_neighbours =
+        texture(t_source, min(fs_uv + vec2(v_texel_size.x, 0.0), v_uv_max)).rgb +
+        texture(t_source, max(fs_uv - vec2(v_texel_size.x, 0.0), vec2(0.0))).rgb +
+        texture(t_source, min(fs_uv + vec2(0.0, v_texel_size.y), v_uv_max)).rgb +
+        texture(t_source, max(fs_uv - vec2(0.0, v_texel_size.y), vec2(0.0))).rgb;
+
+    // unsharp mask against the cross shaped neighbourhood, counters the blur of the bilinear upscale
+    const vec3 v_sharpened = v_center + u_sharpness * (v_center - 0.25 * v_neighbours);
+    out_color = vec4(clamp(v_sharpened, vec3(0.0), vec3(1.0)), 1.0);
+}
@@ -11,8 +11,9 @@ struct Camera
 
 	static Camera FromPhysicsScene(const PhysicsScene& physicsScene)
 	{
-		const auto cameraPositionRaw = physicsScene.Camera->getGlobalPose().p;
-		const auto cameraOrientation = physicsScene.Camera->getGlobalPose().q;
+		const auto& cameraPose = physicsScene.Snapshot().Camera;
+		const auto cameraPositionRaw = cameraPose.p;
+		const auto cameraOrientation = cameraPose.q;
 		const auto cameraDirectionRaw = cameraOrientation.getBasisVector2();
 		const auto cameraPosition = glm::vec3(cameraPositionRaw.x, cameraPositionRaw.y, cameraPositionRaw.z);
 		const auto cameraDirection = glm::vec3(cameraDirectionRaw.x, cameraDirectionRaw.y, cameraDirectionRaw.z);
@@ -1,8 +1,85 @@
 #include "graphics/program.hpp"
+#include "graphics/programbinarycache.hpp"
 
+#include <algorithm>
+#include <array>
+#include <cctype>
 #include <iostream>
 #include <sstream>
 
+// GL_KHR_parallel_shader_compile, the ARB extension uses the same value
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+
+namespace
+{
+    bool IsIdentifierCharacter(const char character)
+    {
+        return std::isalnum(static_cast<unsigned char>(character)) || character == '_';
+    }
+
+    // whether a #if, #ifdef, #ifndef or #elif line names feature as a whole identifier.
+    // Mentions in comments, in code and inside longer identifiers do not count
+    bool IsFeatureTested(const std::string_view source, const std::string_view feature)
+    {
+        constexpr std::array<std::string_view, 4> directives{ "if", "ifdef", "ifndef", "elif" };
+
+        std::size_t lineBegin = 0;
+        while (lineBegin < source.size())
+        {
+            const auto lineEnd = std::min(source.find('\n', lineBegin), source.size());
+            auto line = source.substr(lineBegin, lineEnd - lineBegin);
+            lineBegin = lineEnd + 1;
+
+            const auto hash = line.find_first_not_of(" \t");
+            if (hash == std::string_view::npos || line[hash] != '#')
+            {
+                continue;
+            }
+
+            line = line.substr(0, std::min(line.find("//"), line.find("/*")));
+            const auto directiveBegin = line.find_first_not_of(" \t", hash + 1);
+            if (directiveBegin == std::string_view::npos)
+            {
+                continue;
+            }
+            auto directiveEnd = directiveBegin;
+            while (directiveEnd < line.size() && IsIdentifierCharacter(line[directiveEnd]))
+            {
+                directiveEnd++;
+            }
+            const auto directive = line.substr(directiveBegin, directiveEnd - directiveBegin);
+            if (std::find(directives.begin(), directives.end(), directive) == directives.end())
+            {
+                continue;
+            }
+
+            for (auto tokenBegin = directiveEnd; tokenBegin < line.size();)
+            {
+                if (!IsIdentifierCharacter(line[tokenBegin]))
+                {
+                    tokenBegin++;
+                    continue;
+                }
+
+                auto tokenEnd = tokenBegin;
+                while (tokenEnd < line.size() && IsIdentifierCharacter(line[tokenEnd]))
+                {
+                    tokenEnd++;
+                }
+                if (line.substr(tokenBegin, tokenEnd - tokenBegin) == feature)
+                {
+                    return true;
+                }
+                tokenBegin = tokenEnd;
+            }
+        }
+
+        return false;
+    }
+}
+
 [[nodiscard]] u32 Program::GetId() const
 {
     return _pipeline;
@@ -11,41 +88,456 @@
 Program::Program(
     const std::string_view label,
     const std::string_view vertexShaderFilePath,
-    const std::string_view fragmentShaderFilePath)
+    const std::string_view fragmentShaderFilePath,
+    const ProgramBinaryCache* binaryCache,
+    const std::vector<std::string>& features)
+    : _label{ label },
+    _binaryCache{ binaryCache },
+    _features{ features }
+{
+    _stages.push_back(LoadStage(GL_VERTEX_SHADER, vertexShaderFilePath));
+    _stages.push_back(LoadStage(GL_FRAGMENT_SHADER, fragmentShaderFilePath));
+    SetPermutation(0);
+}
+
+Program::Program(
+    const std::string_view label,
+    const std::string_view computeShaderFilePath,
+    const ProgramBinaryCache* binaryCache,
+    const std::vector<std::string>& features)
+    : _label{ label },
+    _binaryCache{ binaryCache },
+    _features{ features }
+{
+    _stages.push_back(LoadStage(GL_COMPUTE_SHADER, computeShaderFilePath));
+    SetPermutation(0);
+}
+
+Program::~Program()
+{
+    ReleaseRetired();
+
+    for (auto& [permutation, variant] : _variants)
+    {
+        glDeleteProgramPipelines(1, &variant.Pipeline);
+    }
+
+    for (auto& stage : _stages)
+    {
+        for (auto& [permutation, stageProgram] : stage.Programs)
+        {
+            glDeleteShader(stageProgram.Shader);
+            glDeleteProgram(stageProgram.Program);
+        }
+    }
+}
+
+void Program::SetPermutation(const u32 permutation)
+{
+    if (permutation == _permutation)
+    {
+        return;
+    }
+
+    Select(GetOrCreateVariant(permutation));
+    _permutation = permutation;
+}
+
+u32 Program::Permutation() const
+{
+    return _permutation;
+}
+
+void Program::Prepare(const u32 permutation)
+{
+    GetOrCreateVariant(permutation);
+}
+
+bool Program::IsReady()
+{
+    auto& variant = _variants.at(_permutation);
+    if (CompleteVariant(variant, _permutation, false) && variant.IsValid)
+    {
+        Select(variant);
+        return true;
+    }
+
+    if (const auto retired = _retiredVariants.find(_permutation); retired != _retiredVariants.end())
+    {
+        Select(retired->second);
+        return true;
+    }
+
+    // a variant that failed to compile or link is never ready, the passes using it stay off
+    Select(variant);
+    return variant.IsComplete && variant.IsValid;
+}
+
+bool Program::DependsOn(const std::filesystem::path& filePath) const
+{
+    const auto normalizedFilePath = filePath.lexically_normal().string();
+    return std::any_of(_stages.begin(), _stages.end(), [&normalizedFilePath](const Stage& stage)
+    {
+        return stage.Files.find(normalizedFilePath) != stage.Files.end();
+    });
+}
+
+bool Program::Reload()
+{
+    std::vector<Stage> stages;
+    try
+    {
+        for (const auto& stage : _stages)
+        {
+            stages.push_back(LoadStage(stage.Type, stage.FilePath));
+        }
+    }
+    catch (const std::runtime_error& exception)
+    {
+        std::cerr << "SHADER: Reloading " << _label << " failed, " << exception.what() << '\n';
+        return false;
+    }
+
+    // the previous fallback is only replaced by variants that all compiled and work, so saving a
+    // broken shader twice in a row keeps the last working version around
+    const auto isFallback = std::all_of(_variants.begin(), _variants.end(), [](const auto& variant)
+    {
+        return variant.second.IsComplete && variant.second.IsValid;
+    });
+
+    std::vector<u32> permutations;
+    for (auto& [permutation, variant] : _variants)
+    {
+        permutations.push_back(permutation);
+    }
+
+    if (isFallback)
+    {
+        ReleaseRetired();
+        _retiredVariants = std::move(_variants);
+        _retiredStages = std::move(_stages);
+    }
+    else
+    {
+        for (auto& [permutation, variant] : _variants)
+        {
+            glDeleteProgramPipelines(1, &variant.Pipeline);
+        }
+        for (auto& stage : _stages)
+        {
+            for (auto& [permutation, stageProgram] : stage.Programs)
+            {
+                glDeleteShader(stageProgram.Shader);
+                glDeleteProgram(stageProgram.Program);
+            }
+        }
+    }
+    _stages = std::move(stages);
+    _variants.clear();
+
+    const auto selectedPermutation = _permutation;
+    _permutation = ~0u;
+    for (const auto permutation : permutations)
+    {
+        Prepare(permutation);
+    }
+    SetPermutation(selectedPermutation);
+
+    std::clog << "SHADER: Reloading " << _label << '\n';
+    return true;
+}
+
+void Program::SetParallelCompileSupported(const bool isSupported)
+{
+    _isParallelCompileSupported = isSupported;
+}
+
+void Program::Bind()
+{
+    // only waits when there is nothing to fall back to
+    if (!IsReady())
+    {
+        auto& variant = _variants.at(_permutation);
+        CompleteVariant(variant, _permutation, true);
+        Select(variant);
+    }
+
+    glBindProgramPipeline(_pipeline);
+}
+
+Program::Stage Program::LoadStage(const u32 type, const std::string_view filePath) const
+{
+    std::unordered_set<std::string> includedFiles{ std::filesystem::path(filePath).lexically_normal().string() };
+    auto source = ExpandIncludes(filePath, includedFiles);
+
+    auto featureMask = 0u;
+    for (std::size_t i = 0; i < _features.size(); i++)
+    {
+        if (IsFeatureTested(source, _features[i]))
+        {
+            featureMask |= 1u << i;
+        }
+    }
+
+    return { type, std::string(filePath), std::move(source), featureMask, std::move(includedFiles), {} };
+}
+
+void Program::Select(const Variant& variant)
+{
+    _pipeline = variant.Pipeline;
+    _vertexShader = variant.VertexShader;
+    _fragmentShader = variant.FragmentShader;
+    _computeShader = variant.ComputeShader;
+}
+
+void Program::ReleaseRetired()
 {
-    auto const vertexShaderSource = ReadTextFile(vertexShaderFilePath);
-    auto const fragmentShaderSource = ReadTextFile(fragmentShaderFilePath);
+    for (auto& [permutation, variant] : _retiredVariants)
+    {
+        glDeleteProgramPipelines(1, &variant.Pipeline);
+    }
+    _retiredVariants.clear();
+
+    for (auto& stage : _retiredStages)
+    {
+        for (auto& [permutation, stageProgram] : stage.Programs)
+        {
+            glDeleteShader(stageProgram.Shader);
+            glDeleteProgram(stageProgram.Program);
+        }
+    }
+    _retiredStages.clear();
+}
+
+Program::Variant& Program::GetOrCreateVariant(const u32 permutation)
+{
+    const auto variant = _variants.find(permutation);
+    if (variant != _variants.end())
+    {
+        return variant->second;
+    }
+
+    // the pipeline is put together once all stages have linked, see CompleteVariant
+    Variant newVariant{};
+    for (auto& stage : _stages)
+    {
+        const auto program = GetOrCreateStageProgram(stage, permutation).Program;
+        switch (stage.Type)
+        {
+            case GL_VERTEX_SHADER: newVariant.VertexShader = program; break;
+            case GL_FRAGMENT_SHADER: newVariant.FragmentShader = program; break;
+            case GL_COMPUTE_SHADER: newVariant.ComputeShader = program; break;
+        }
+    }
+
+    return _variants.emplace(permutation, newVariant).first->second;
+}
 
-    auto const vertexShaderData = vertexShaderSource.data();
-    auto const fragmentShaderData = fragmentShaderSource.data();
+Program::StageProgram& Program::GetOrCreateStageProgram(Stage& stage, const u32 permutation)
+{
+    const auto stagePermutation = permutation & stage.FeatureMask;
+    const auto stageProgram = stage.Programs.find(stagePermutation);
+    if (stageProgram != stage.Programs.end())
+    {
+        return stageProgram->second;
+    }
 
-    _vertexShader = glCreateShaderProgramv(GL_VERTEX_SHADER, 1, &vertexShaderData);
-    _fragmentShader = glCreateShaderProgramv(GL_FRAGMENT_SHADER, 1, &fragmentShaderData);
+    const auto source = InjectDefines(stage.Source, _features, stage.FeatureMask, stagePermutation);
+    const auto newStageProgram = BeginShaderProgram(stage.Type, source, _binaryCache);
 #ifdef _DEBUG
-    glObjectLabel(GL_PROGRAM, _vertexShader, static_cast<GLsizei>(vertexShaderFilePath.length()), vertexShaderFilePath.data());
-    glObjectLabel(GL_PROGRAM, _fragmentShader, static_cast<GLsizei>(fragmentShaderFilePath.length()), fragmentShaderFilePath.data());
+    glObjectLabel(GL_PROGRAM, newStageProgram.Program, static_cast<GLsizei>(stage.FilePath.length()), stage.FilePath.data());
 #endif
-    ValidateProgram(_vertexShader, vertexShaderFilePath);
-    ValidateProgram(_fragmentShader, fragmentShaderFilePath);
+    return stage.Programs.emplace(stagePermutation, newStageProgram).first->second;
+}
+
+bool Program::CompleteVariant(Variant& variant, const u32 permutation, const bool wait)
+{
+    if (variant.IsComplete)
+    {
+        return true;
+    }
+
+    for (auto& stage : _stages)
+    {
+        auto& stageProgram = stage.Programs.at(permutation & stage.FeatureMask);
+        if (!wait && !IsShaderProgramComplete(stageProgram))
+        {
+            return false;
+        }
+    }
 
-    glCreateProgramPipelines(1, &_pipeline);
-    glUseProgramStages(_pipeline, GL_VERTEX_SHADER_BIT, _vertexShader);
-    glUseProgramStages(_pipeline, GL_FRAGMENT_SHADER_BIT, _fragmentShader);
+    glCreateProgramPipelines(1, &variant.Pipeline);
+    variant.IsValid = true;
+    for (auto& stage : _stages)
+    {
+        auto& stageProgram = stage.Programs.at(permutation & stage.FeatureMask);
+        FinishShaderProgram(stageProgram, stage.FilePath, _binaryCache);
+        variant.IsValid = variant.IsValid && stageProgram.IsValid;
+        switch (stage.Type)
+        {
+            case GL_VERTEX_SHADER: glUseProgramStages(variant.Pipeline, GL_VERTEX_SHADER_BIT, stageProgram.Program); break;
+            case GL_FRAGMENT_SHADER: glUseProgramStages(variant.Pipeline, GL_FRAGMENT_SHADER_BIT, stageProgram.Program); break;
+            case GL_COMPUTE_SHADER: glUseProgramStages(variant.Pipeline, GL_COMPUTE_SHADER_BIT, stageProgram.Program); break;
+        }
+    }
 #ifdef _DEBUG
-    glObjectLabel(GL_PROGRAM_PIPELINE, _pipeline, static_cast<GLsizei>(label.length()), label.data());
+    glObjectLabel(GL_PROGRAM_PIPELINE, variant.Pipeline, static_cast<GLsizei>(_label.length()), _label.data());
 #endif
+
+    variant.IsComplete = true;
+    return true;
 }
 
-Program::~Program()
+std::string Program::ExpandIncludes(const std::filesystem::path& filePath, std::unordered_set<std::string>& includedFiles)
 {
-    glDeleteProgramPipelines(1, &_pipeline);
-    glDeleteProgram(_vertexShader);
-    glDeleteProgram(_fragmentShader);
+    const auto source = ReadTextFile(filePath);
+
+    std::istringstream lines(source);
+    std::ostringstream expanded;
+    std::string line;
+    auto lineNumber = 0;
+    while (std::getline(lines, line))
+    {
+        lineNumber++;
+
+        const auto directive = line.find("#include");
+        if (directive == std::string::npos || line.find_first_not_of(" \t") != directive)
+        {
+            expanded << line << '\n';
+            continue;
+        }
+
+        const auto open = line.find('"', directive);
+        const auto close = open != std::string::npos ? line.find('"', open + 1) : std::string::npos;
+        if (close == std::string::npos)
+        {
+            throw std::runtime_error("SHADER: " + filePath.string() + "(" + std::to_string(lineNumber) + "): expected #include \"file\"");
+        }
+
+        // paths are relative to the including file, every file is included at most once
+        const auto includePath = (filePath.parent_path() / line.substr(open + 1, close - open - 1)).lexically_normal();
+        if (includedFiles.insert(includePath.string()).second)
+        {
+            expanded << "#line 1\n" << ExpandIncludes(includePath, includedFiles);
+        }
+        expanded << "#line " << lineNumber + 1 << '\n';
+    }
+
+    return expanded.str();
 }
 
-void Program::Bind() const
+std::string Program::InjectDefines(const std::string& source, const std::vector<std::string>& features, const u32 featureMask, const u32 permutation)
 {
-    glBindProgramPipeline(_pipeline);
+    if (featureMask == 0)
+    {
+        return source;
+    }
+
+    // #version has to stay the first directive, the defines go right after it
+    const auto version = source.find("#version");
+    if (version == std::string::npos)
+    {
+        return source;
+    }
+
+    const auto versionEnd = source.find('\n', version);
+    if (versionEnd == std::string::npos)
+    {
+        return source;
+    }
+
+    const auto versionLine = std::count(source.begin(), source.begin() + static_cast<std::ptrdiff_t>(version), '\n') + 1;
+
+    std::ostringstream defines;
+    for (std::size_t i = 0; i < features.size(); i++)
+    {
+        if ((featureMask & (1u << i)) != 0)
+        {
+            defines << "#define " << features[i] << ((permutation & (1u << i)) != 0 ? " 1\n" : " 0\n");
+        }
+    }
+    defines << "#line " << versionLine + 1 << '\n';
+
+    auto result = source;
+    result.insert(versionEnd + 1, defines.str());
+    return result;
+}
+
+Program::StageProgram Program::BeginShaderProgram(const u32 stage, const std::string& source, const ProgramBinaryCache* binaryCache)
+{
+    auto const key = binaryCache != nullptr ? binaryCache->Key(stage, source) : 0;
+    if (binaryCache != nullptr)
+    {
+        if (auto const cachedProgram = binaryCache->Load(key); cachedProgram != 0)
+        {
+            return { cachedProgram, 0, key, true, true };
+        }
+    }
+
+    // what glCreateShaderProgramv does, plus the hint that lets the binary be read back afterwards.
+    // Nothing here asks for a status, so a driver compiling in the background returns right away
+    auto const shader = glCreateShader(stage);
+    auto const sourceData = source.data();
+    glShaderSource(shader, 1, &sourceData, nullptr);
+    glCompileShader(shader);
+
+    auto const program = glCreateProgram();
+    glProgramParameteri(program, GL_PROGRAM_SEPARABLE, GL_TRUE);
+    glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    glAttachShader(program, shader);
+    glLinkProgram(program);
+
+    return { program, shader, key, false, false };
+}
+
+bool Program::IsShaderProgramComplete(const StageProgram& stageProgram)
+{
+    if (stageProgram.IsComplete || !_isParallelCompileSupported)
+    {
+        // without the extension every status query waits anyway
+        return true;
+    }
+
+    auto isComplete = 0;
+    glGetProgramiv(stageProgram.Program, GL_COMPLETION_STATUS_KHR, &isComplete);
+    return isComplete == GL_TRUE;
+}
+
+void Program::FinishShaderProgram(StageProgram& stageProgram, const std::string_view filePath, const ProgramBinaryCache* binaryCache)
+{
+    if (stageProgram.IsComplete)
+    {
+        return;
+    }
+    stageProgram.IsComplete = true;
+
+    auto compiled = 0;
+    glGetShaderiv(stageProgram.Shader, GL_COMPILE_STATUS, &compiled);
+    if (compiled == GL_FALSE)
+    {
+        std::array<char, 1024> compilerLog{};
+        glGetShaderInfoLog(stageProgram.Shader, static_cast<u32>(compilerLog.size()), nullptr, compilerLog.data());
+
+        std::ostringstream message;
+        message << "SHADER: " << filePath << " contains error(s):\n\n" << compilerLog.data() << '\n';
+        std::cout << message.str();
+    }
+    else
+    {
+        auto linked = 0;
+        glGetProgramiv(stageProgram.Program, GL_LINK_STATUS, &linked);
+        stageProgram.IsValid = linked == GL_TRUE;
+        if (stageProgram.IsValid && binaryCache != nullptr)
+        {
+            binaryCache->Store(stageProgram.Key, stageProgram.Program);
+        }
+
+        ValidateProgram(stageProgram.Program, filePath);
+    }
+
+    glDetachShader(stageProgram.Program, stageProgram.Shader);
+    glDeleteShader(stageProgram.Shader);
+    stageProgram.Shader = 0;
 }
 
 void Program::ValidateProgram(const u32 shader, const std::string_view filename)
@@ -63,4 +555,4 @@ void Program::ValidateProgram(const u32 shader, const std::string_view filename)
         message << "SHADER: " << filename << " contains error(s):\n\n" << compilerLog.data() << '\n';
         std::cout << message.str();
     }
-}
\ No newline at end of file
+}
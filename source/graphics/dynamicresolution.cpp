@@ -0,0 +1,92 @@
+#include "graphics/dynamicresolution.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+DynamicResolution::DynamicResolution(
+    const f32 targetMilliseconds,
+    const f32 minScale,
+    const f32 maxScale)
+    : _targetMilliseconds{ targetMilliseconds },
+    _minScale{ minScale },
+    _maxScale{ maxScale },
+    _scale{ maxScale },
+    _smoothedMilliseconds{ targetMilliseconds }
+{
+}
+
+void DynamicResolution::Update(const f32 gpuMilliseconds)
+{
+    // gains are tuned for per frame updates with a few frames of measurement latency, a higher
+    // proportional gain overshoots because the timings describe frames rendered at an older scale
+    auto constexpr proportionalGain = 0.06f;
+    auto constexpr integralGain = 0.004f;
+    auto constexpr derivativeGain = 0.02f;
+    auto constexpr smoothing = 0.1f;
+    auto constexpr maxIntegral = 4.0f;
+
+    if (!_isEnabled || gpuMilliseconds <= 0.0f)
+    {
+        return;
+    }
+
+    _smoothedMilliseconds += smoothing * (gpuMilliseconds - _smoothedMilliseconds);
+
+    // positive when there is headroom left in the budget
+    const auto error = (_targetMilliseconds - _smoothedMilliseconds) / _targetMilliseconds;
+    _integral = std::clamp(_integral + error, -maxIntegral, maxIntegral);
+    const auto derivative = error - _previousError;
+    _previousError = error;
+
+    const auto adjustment = proportionalGain * error + integralGain * _integral + derivativeGain * derivative;
+    const auto scale = std::clamp(_scale + adjustment, _minScale, _maxScale);
+
+    // stop the integral from winding up while the scale sits at one of its limits
+    if (scale != _scale + adjustment)
+    {
+        _integral -= error;
+    }
+    _scale = scale;
+}
+
+void DynamicResolution::SetEnabled(const bool isEnabled)
+{
+    _isEnabled = isEnabled;
+    if (!_isEnabled)
+    {
+        _scale = _maxScale;
+        _integral = 0.0f;
+        _previousError = 0.0f;
+    }
+}
+
+bool DynamicResolution::IsEnabled() const
+{
+    return _isEnabled;
+}
+
+f32 DynamicResolution::Scale() const
+{
+    return _scale;
+}
+
+glm::ivec2 DynamicResolution::RenderSize(const glm::ivec2& maxSize) const
+{
+    auto constexpr granularity = 8;
+
+    const auto roundToGranularity = [&](const s32 size)
+    {
+        const auto scaled = static_cast<s32>(std::lround(static_cast<f32>(size) * _scale / granularity)) * granularity;
+        return std::clamp(scaled, std::min(granularity, size), size);
+    };
+
+    return glm::ivec2(roundToGranularity(maxSize.x), roundToGranularity(maxSize.y));
+}
+
+glm::vec2 DynamicResolution::UvScale(const glm::ivec2& maxSize, const glm::ivec2& targetSize) const
+{
+    const auto renderSize = RenderSize(maxSize);
+    return glm::vec2(
+        static_cast<f32>(renderSize.x) / static_cast<f32>(targetSize.x),
+        static_cast<f32>(renderSize.y) / static_cast<f32>(targetSize.y));
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include "types.hpp"
+
+#include <glm/glm.hpp>
+
+// Picks a render scale from measured gpu frame times. A pid controller drives the scale so the
+// frame time settles at the target budget, the scene is rendered into the top left sub rectangle
+// of full size targets and upscaled to the window afterwards.
+class DynamicResolution final
+{
+public:
+    DynamicResolution(
+        const f32 targetMilliseconds,
+        const f32 minScale = 0.5f,
+        const f32 maxScale = 1.0f);
+
+    void Update(const f32 gpuMilliseconds);
+
+    void SetEnabled(const bool isEnabled);
+    [[nodiscard]] bool IsEnabled() const;
+
+    [[nodiscard]] f32 Scale() const;
+    // render size for an output of maxSize, rounded to multiples of 8 so small scale changes do not resize every frame
+    [[nodiscard]] glm::ivec2 RenderSize(const glm::ivec2& maxSize) const;
+    // fraction of targets of targetSize covered by the render size, the uvs diff uniforms of the post passes
+    [[nodiscard]] glm::vec2 UvScale(const glm::ivec2& maxSize, const glm::ivec2& targetSize) const;
+
+private:
+    f32 _targetMilliseconds{};
+    f32 _minScale{};
+    f32 _maxScale{};
+    f32 _scale{ 1.0f };
+
+    f32 _smoothedMilliseconds{};
+    f32 _integral{};
+    f32 _previousError{};
+    bool _isEnabled{ true };
+};
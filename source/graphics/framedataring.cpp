@@ -0,0 +1,149 @@
+#include "graphics/framedataring.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <tuple>
+#include <string_view>
+
+namespace
+{
+    constexpr auto kMapFlags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+}
+
+std::pair<u32, u8*> FrameDataRing::CreateMappedBuffer(const u32 size)
+{
+    u32 id{};
+    glCreateBuffers(1, &id);
+#ifdef _DEBUG
+    constexpr std::string_view label = "B_FrameDataRing";
+    glObjectLabel(GL_BUFFER, id, static_cast<GLsizei>(label.length()), label.data());
+#endif
+    glNamedBufferStorage(id, size, nullptr, kMapFlags);
+    const auto data = static_cast<u8*>(glMapNamedBufferRange(id, 0, size, kMapFlags));
+    if (data == nullptr)
+    {
+        glDeleteBuffers(1, &id);
+        throw std::runtime_error("FrameDataRing: unable to map buffer persistently");
+    }
+
+    return { id, data };
+}
+
+void FrameDataRing::DeleteMappedBuffer(const u32 id)
+{
+    glUnmapNamedBuffer(id);
+    glDeleteBuffers(1, &id);
+}
+
+FrameDataRing::FrameDataRing(const u32 regionSize, const u32 regionCount)
+    : _regionCount{ regionCount },
+    _spillBuffers(regionCount)
+{
+    s32 uniformAlignment = 0;
+    s32 storageAlignment = 0;
+    glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &uniformAlignment);
+    glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &storageAlignment);
+    _alignment = static_cast<u32>(std::max({ uniformAlignment, storageAlignment, 16 }));
+    _regionSize = (regionSize + _alignment - 1) / _alignment * _alignment;
+    std::tie(_id, _data) = CreateMappedBuffer(_regionSize * _regionCount);
+}
+
+FrameDataRing::~FrameDataRing()
+{
+    for (const auto& spillBuffers : _spillBuffers)
+    {
+        for (const auto& spillBuffer : spillBuffers)
+        {
+            DeleteMappedBuffer(spillBuffer.Id);
+        }
+    }
+    DeleteMappedBuffer(_id);
+}
+
+void FrameDataRing::BeginFrame(const u32 regionIndex)
+{
+    _regionIndex = regionIndex % _regionCount;
+    _cursor = 0;
+    _frameSize = 0;
+
+    // the gpu is done with this region, so also with what spilled out of it
+    for (const auto& spillBuffer : _spillBuffers[_regionIndex])
+    {
+        DeleteMappedBuffer(spillBuffer.Id);
+    }
+    _spillBuffers[_regionIndex].clear();
+
+    // with headroom, a scene that keeps growing does not reallocate every frame. The gl keeps the old
+    // buffer alive until the frames still in flight are done reading their regions of it
+    if (_largestFrameSize > _regionSize)
+    {
+        const auto regionSize = (_largestFrameSize + _largestFrameSize / 2 + _alignment - 1) / _alignment * _alignment;
+        const auto [id, data] = CreateMappedBuffer(regionSize * _regionCount);
+        DeleteMappedBuffer(_id);
+        _id = id;
+        _data = data;
+        _regionSize = regionSize;
+        std::clog << "FrameDataRing: Grew regions to " << _regionSize / 1024 << " KiB\n";
+    }
+}
+
+FrameDataAllocation FrameDataRing::Allocate(const u32 size)
+{
+    const auto alignedSize = (size + _alignment - 1) / _alignment * _alignment;
+    _frameSize += alignedSize;
+    _largestFrameSize = std::max(_largestFrameSize, _frameSize);
+
+    if (_cursor + alignedSize <= _regionSize)
+    {
+        const auto offset = _regionIndex * _regionSize + _cursor;
+        _cursor += alignedSize;
+        return { _id, offset, size, _data + offset };
+    }
+
+    auto& spillBuffers = _spillBuffers[_regionIndex];
+    if (spillBuffers.empty() || spillBuffers.back().Cursor + alignedSize > spillBuffers.back().Size)
+    {
+        const auto spillSize = std::max(alignedSize, _regionSize);
+        const auto [id, data] = CreateMappedBuffer(spillSize);
+        spillBuffers.push_back({ id, data, spillSize, 0 });
+    }
+
+    auto& spillBuffer = spillBuffers.back();
+    const auto offset = spillBuffer.Cursor;
+    spillBuffer.Cursor += alignedSize;
+    return { spillBuffer.Id, offset, size, spillBuffer.Data + offset };
+}
+
+FrameDataAllocation FrameDataRing::Write(const void* data, const u32 size)
+{
+    const auto allocation = Allocate(size);
+    std::memcpy(allocation.Data, data, size);
+    return allocation;
+}
+
+void FrameDataRing::BindAsUniformBuffer(const u32 bindingIndex, const FrameDataAllocation& allocation) const
+{
+    glBindBufferRange(GL_UNIFORM_BUFFER, bindingIndex, allocation.Buffer, allocation.Offset, allocation.Size);
+}
+
+void FrameDataRing::BindAsStorageBuffer(const u32 bindingIndex, const FrameDataAllocation& allocation) const
+{
+    glBindBufferRange(GL_SHADER_STORAGE_BUFFER, bindingIndex, allocation.Buffer, allocation.Offset, allocation.Size);
+}
+
+u32 FrameDataRing::Id() const
+{
+    return _id;
+}
+
+u32 FrameDataRing::RegionSize() const
+{
+    return _regionSize;
+}
+
+u32 FrameDataRing::RegionCount() const
+{
+    return _regionCount;
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+#include "types.hpp"
+
+#include <glad/glad.h>
+
+#include <utility>
+#include <vector>
+
+struct FrameDataAllocation
+{
+    u32 Buffer;
+    u32 Offset;
+    u32 Size;
+    void* Data;
+};
+
+// One persistently mapped, coherent buffer split into regionCount regions, one per frame in flight.
+// Every frame writes its uniform and instance data into its region with plain memcpys and binds
+// sub ranges of it. The caller guarantees the gpu is done with a region before reusing it.
+// A frame that outgrows its region spills into extra buffers, they live until the region comes around
+// again. The next BeginFrame then grows every region to fit the largest frame seen so far.
+class FrameDataRing final
+{
+public:
+    FrameDataRing(const u32 regionSize, const u32 regionCount = 3);
+    ~FrameDataRing();
+
+    FrameDataRing(const FrameDataRing&) = delete;
+    FrameDataRing& operator=(const FrameDataRing&) = delete;
+
+    // starts writing at the beginning of the given region, see FramesInFlight
+    void BeginFrame(const u32 regionIndex);
+
+    // never fails, past the end of the region the allocation comes from a spill buffer
+
+    [[nodiscard]] FrameDataAllocation Allocate(const u32 size);
+
+    template <typename T>
+    [[nodiscard]] FrameDataAllocation Write(const T& value)
+    {
+        return Write(&value, sizeof(T));
+    }
+
+    template <typename T>
+    [[nodiscard]] FrameDataAllocation Write(const std::vector<T>& values)
+    {
+        return Write(values.data(), static_cast<u32>(values.size() * sizeof(T)));
+    }
+
+    [[nodiscard]] FrameDataAllocation Write(const void* data, const u32 size);
+
+    void BindAsUniformBuffer(const u32 bindingIndex, const FrameDataAllocation& allocation) const;
+    void BindAsStorageBuffer(const u32 bindingIndex, const FrameDataAllocation& allocation) const;
+
+    [[nodiscard]] u32 Id() const;
+    [[nodiscard]] u32 RegionSize() const;
+    [[nodiscard]] u32 RegionCount() const;
+
+private:
+    struct SpillBuffer
+    {
+        u32 Id;
+        u8* Data;
+        u32 Size;
+        u32 Cursor;
+    };
+
+    [[nodiscard]] static std::pair<u32, u8*> CreateMappedBuffer(const u32 size);
+    static void DeleteMappedBuffer(const u32 id);
+
+    u32 _id{};
+    u8* _data{};
+    u32 _alignment{};
+    u32 _regionSize{};
+    u32 _regionCount{};
+    u32 _regionIndex{};
+    u32 _cursor{};
+    // what the current frame asked for in total and the most any frame asked for
+    u32 _frameSize{};
+    u32 _largestFrameSize{};
+    // per region, released once the region is written again
+    std::vector<std::vector<SpillBuffer>> _spillBuffers;
+};
@@ -0,0 +1,65 @@
+#include "graphics/framesinflight.hpp"
+
+#include <algorithm>
+
+FramesInFlight::FramesInFlight(const u32 depth)
+    : _fences(std::max(depth, 1u), nullptr),
+    _depth{ std::max(depth, 1u) }
+{
+}
+
+FramesInFlight::~FramesInFlight()
+{
+    for (auto& fence : _fences)
+    {
+        if (fence != nullptr)
+        {
+            glDeleteSync(fence);
+        }
+    }
+}
+
+u32 FramesInFlight::BeginFrame()
+{
+    auto& fence = _fences[CurrentSlot()];
+    if (fence != nullptr)
+    {
+        // the first wait does not flush, if the fence is still pending the commands are flushed so it can signal
+        auto waitFlags = 0u;
+        while (true)
+        {
+            const auto waitResult = glClientWaitSync(fence, waitFlags, 1000000);
+            if (waitResult == GL_ALREADY_SIGNALED || waitResult == GL_CONDITION_SATISFIED || waitResult == GL_WAIT_FAILED)
+            {
+                break;
+            }
+            waitFlags = GL_SYNC_FLUSH_COMMANDS_BIT;
+        }
+
+        glDeleteSync(fence);
+        fence = nullptr;
+    }
+
+    return CurrentSlot();
+}
+
+void FramesInFlight::EndFrame()
+{
+    _fences[CurrentSlot()] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    _frameIndex++;
+}
+
+u32 FramesInFlight::CurrentSlot() const
+{
+    return static_cast<u32>(_frameIndex % _depth);
+}
+
+u32 FramesInFlight::Depth() const
+{
+    return _depth;
+}
+
+u64 FramesInFlight::FrameIndex() const
+{
+    return _frameIndex;
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include "types.hpp"
+
+#include <glad/glad.h>
+
+#include <vector>
+
+// Lets the cpu record up to Depth frames ahead of the gpu. Every frame slot is fenced when its
+// commands are submitted, BeginFrame waits on the fence of the slot it is about to reuse, after
+// which everything the slot indexes (ring regions, readbacks) is safe to overwrite.
+class FramesInFlight final
+{
+public:
+    explicit FramesInFlight(const u32 depth);
+    ~FramesInFlight();
+
+    FramesInFlight(const FramesInFlight&) = delete;
+    FramesInFlight& operator=(const FramesInFlight&) = delete;
+
+    // returns the slot the new frame may write into
+    u32 BeginFrame();
+    void EndFrame();
+
+    [[nodiscard]] u32 CurrentSlot() const;
+    [[nodiscard]] u32 Depth() const;
+    [[nodiscard]] u64 FrameIndex() const;
+
+private:
+    std::vector<GLsync> _fences;
+    u32 _depth{};
+    u64 _frameIndex{};
+};
@@ -107,7 +107,7 @@ void Geometry::Draw() const
 
 void Geometry::DrawInstanced(const u32 instanceCount) const
 {
-    if (_indexCount == 0)
+    if (_indexCount == 0 || _indexCount == _vertexCount)
     {
         glDrawArraysInstancedBaseInstance(GL_TRIANGLES, 0, _vertexCount, instanceCount, 0);
     }
@@ -117,6 +117,13 @@ void Geometry::DrawInstanced(const u32 instanceCount) const
     }
 }
 
+void Geometry::DrawIndirect(const Buffer& drawCommandBuffer) const
+{
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, drawCommandBuffer.Id());
+    glDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, nullptr);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+}
+
 void Geometry::DrawArrays() const
 {
     glDrawArraysInstancedBaseInstance(GL_TRIANGLES, 0, _vertexCount, 1, 0);
@@ -127,6 +134,16 @@ void Geometry::DrawElements() const
     glDrawElementsInstancedBaseInstance(GL_TRIANGLES, _indexCount, GL_UNSIGNED_INT, nullptr, 1, 0);
 }
 
+u32 Geometry::IndexCount() const
+{
+    return _indexCount;
+}
+
+const BoundingBox& Geometry::Bounds() const
+{
+    return _bounds;
+}
+
 Geometry::Geometry()
 {
     glCreateVertexArrays(1, &_vao);
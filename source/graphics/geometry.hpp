@@ -4,6 +4,7 @@
 #include "types.hpp"
 #include "graphics/buffer.hpp"
 #include "graphics/vertexformats.hpp"
+#include "math/bounds.hpp"
 
 #include <glad/glad.h>
 #include <glm/glm.hpp>
@@ -23,6 +24,15 @@ struct AttributeFormat
 	u32 RelativeOffset;
 };
 
+struct DrawElementsIndirectCommand
+{
+	u32 Count;
+	u32 InstanceCount;
+	u32 FirstIndex;
+	s32 BaseVertex;
+	u32 BaseInstance;
+};
+
 class Geometry final
 {
 public:
@@ -35,7 +45,9 @@ public:
 	Geometry(
 		const Buffer& vertexBuffer,
 		const Buffer& indexBuffer,
-		const enum VertexType vertexType)
+		const enum VertexType vertexType,
+		const BoundingBox& bounds)
+		: _bounds{ bounds }
 	{
 		glCreateVertexArrays(1, &_vao);
 #ifdef _DEBUG
@@ -55,9 +67,13 @@ public:
 	void Bind() const;
 	void Draw() const;
 	void DrawInstanced(const u32 instanceCount) const;
+	void DrawIndirect(const Buffer& drawCommandBuffer) const;
 	void DrawArrays() const;
 	void DrawElements() const;
 
+	[[nodiscard]] u32 IndexCount() const;
+	[[nodiscard]] const BoundingBox& Bounds() const;
+
 	~Geometry();
 private:
 	Geometry();
@@ -172,6 +188,8 @@ private:
 
 	u32 _vao{};
 
+	BoundingBox _bounds{};
+
 	static inline std::unordered_map<VertexType, std::string> _names
 	{
 		{ VertexType::Position, "Position" },
@@ -0,0 +1,235 @@
+#include "graphics/gpuprofiler.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+
+GpuProfiler::GpuProfiler(const u32 frameDepth, const u32 historySize)
+    : _frames(std::max(frameDepth, 2u)),
+    _historySize{ std::max(historySize, 1u) }
+{
+}
+
+GpuProfiler::~GpuProfiler()
+{
+    for (auto& frame : _frames)
+    {
+        if (!frame.Queries.empty())
+        {
+            glDeleteQueries(static_cast<GLsizei>(frame.Queries.size()), frame.Queries.data());
+        }
+    }
+}
+
+void GpuProfiler::BeginFrame()
+{
+    auto& frame = _frames[_frameIndex % _frames.size()];
+    Collect(frame);
+
+    frame.Scopes.clear();
+    frame.UsedQueryCount = 0;
+}
+
+void GpuProfiler::EndFrame()
+{
+    if (!_openScopes.empty())
+    {
+        std::cerr << "GpuProfiler: " << _openScopes.size() << " scopes still open at the end of the frame\n";
+        _openScopes.clear();
+    }
+    _frameIndex++;
+}
+
+void GpuProfiler::PushScope(const u32 id, const std::string_view name)
+{
+    glPushDebugGroup(GL_DEBUG_SOURCE_APPLICATION, id, static_cast<GLsizei>(name.length()), name.data());
+
+    auto& frame = _frames[_frameIndex % _frames.size()];
+    const auto beginQuery = AcquireQuery(frame);
+    glQueryCounter(beginQuery, GL_TIMESTAMP);
+
+    _openScopes.push_back(static_cast<u32>(frame.Scopes.size()));
+    frame.Scopes.push_back({ ScopeIndex(name), beginQuery, 0 });
+}
+
+void GpuProfiler::PopScope()
+{
+    auto& frame = _frames[_frameIndex % _frames.size()];
+    if (_openScopes.empty())
+    {
+        return;
+    }
+
+    auto& scope = frame.Scopes[_openScopes.back()];
+    _openScopes.pop_back();
+
+    scope.EndQuery = AcquireQuery(frame);
+    glQueryCounter(scope.EndQuery, GL_TIMESTAMP);
+
+    glPopDebugGroup();
+}
+
+std::vector<GpuProfilerStatistics> GpuProfiler::Statistics() const
+{
+    std::vector<GpuProfilerStatistics> statistics;
+    statistics.reserve(_scopes.size());
+
+    std::vector<f32> sorted;
+    for (const auto& scope : _scopes)
+    {
+        if (scope.Samples.empty())
+        {
+            continue;
+        }
+
+        sorted = scope.Samples;
+        std::sort(sorted.begin(), sorted.end());
+
+        auto sum = 0.0;
+        for (const auto sample : sorted)
+        {
+            sum += sample;
+        }
+
+        const auto lastSample = scope.Samples[(scope.NextSample + scope.Samples.size() - 1) % scope.Samples.size()];
+        const auto p99Index = std::min(sorted.size() - 1, static_cast<size_t>(0.99 * static_cast<f64>(sorted.size())));
+        statistics.push_back(
+        {
+            scope.Name,
+            lastSample,
+            sorted.front(),
+            static_cast<f32>(sum / static_cast<f64>(sorted.size())),
+            sorted[p99Index],
+            static_cast<u32>(sorted.size())
+        });
+    }
+
+    return statistics;
+}
+
+f32 GpuProfiler::LatestMilliseconds(const std::string_view name) const
+{
+    const auto it = _scopeIndices.find(std::string(name));
+    if (it == _scopeIndices.end())
+    {
+        return 0.0f;
+    }
+
+    const auto& scope = _scopes[it->second];
+    if (scope.Samples.empty())
+    {
+        return 0.0f;
+    }
+
+    return scope.Samples[(scope.NextSample + scope.Samples.size() - 1) % scope.Samples.size()];
+}
+
+void GpuProfiler::ExportCsv(const std::filesystem::path& filePath) const
+{
+    std::ofstream file(filePath);
+    if (!file)
+    {
+        std::cerr << "GpuProfiler: Unable to write " << filePath << '\n';
+        return;
+    }
+
+    file << "pass,last_ms,min_ms,avg_ms,p99_ms,samples\n";
+    for (const auto& statistic : Statistics())
+    {
+        file << statistic.Name << ',' << statistic.LastMilliseconds << ',' << statistic.MinMilliseconds << ','
+            << statistic.AverageMilliseconds << ',' << statistic.P99Milliseconds << ',' << statistic.SampleCount << '\n';
+    }
+}
+
+void GpuProfiler::ExportJson(const std::filesystem::path& filePath) const
+{
+    std::ofstream file(filePath);
+    if (!file)
+    {
+        std::cerr << "GpuProfiler: Unable to write " << filePath << '\n';
+        return;
+    }
+
+    const auto statistics = Statistics();
+    file << "{\n  \"passes\": [\n";
+    for (size_t i = 0; i < statistics.size(); i++)
+    {
+        const auto& statistic = statistics[i];
+        file << "    { \"name\": \"" << statistic.Name << "\""
+            << ", \"last_ms\": " << statistic.LastMilliseconds
+            << ", \"min_ms\": " << statistic.MinMilliseconds
+            << ", \"avg_ms\": " << statistic.AverageMilliseconds
+            << ", \"p99_ms\": " << statistic.P99Milliseconds
+            << ", \"samples\": " << statistic.SampleCount << " }"
+            << (i + 1 < statistics.size() ? ",\n" : "\n");
+    }
+    file << "  ]\n}\n";
+}
+
+u32 GpuProfiler::AcquireQuery(FrameQueries& frame)
+{
+    if (frame.UsedQueryCount == frame.Queries.size())
+    {
+        u32 query{};
+        glCreateQueries(GL_TIMESTAMP, 1, &query);
+        frame.Queries.push_back(query);
+    }
+
+    return frame.Queries[frame.UsedQueryCount++];
+}
+
+void GpuProfiler::Collect(FrameQueries& frame)
+{
+    if (frame.Scopes.empty())
+    {
+        return;
+    }
+
+    // queries complete in order, if the last one is not available yet the frame is dropped instead of waiting
+    s32 isAvailable = 0;
+    glGetQueryObjectiv(frame.Queries[frame.UsedQueryCount - 1], GL_QUERY_RESULT_AVAILABLE, &isAvailable);
+    if (!isAvailable)
+    {
+        return;
+    }
+
+    for (const auto& scopeQuery : frame.Scopes)
+    {
+        if (scopeQuery.EndQuery == 0)
+        {
+            continue;
+        }
+
+        GLuint64 beginTime{};
+        GLuint64 endTime{};
+        glGetQueryObjectui64v(scopeQuery.BeginQuery, GL_QUERY_RESULT, &beginTime);
+        glGetQueryObjectui64v(scopeQuery.EndQuery, GL_QUERY_RESULT, &endTime);
+
+        auto& scope = _scopes[scopeQuery.ScopeIndex];
+        const auto milliseconds = static_cast<f32>(static_cast<f64>(endTime - beginTime) / 1000000.0);
+        if (scope.Samples.size() < _historySize)
+        {
+            scope.Samples.push_back(milliseconds);
+        }
+        else
+        {
+            scope.Samples[scope.NextSample] = milliseconds;
+        }
+        scope.NextSample = (scope.NextSample + 1) % _historySize;
+    }
+}
+
+u32 GpuProfiler::ScopeIndex(const std::string_view name)
+{
+    const auto key = std::string(name);
+    const auto it = _scopeIndices.find(key);
+    if (it != _scopeIndices.end())
+    {
+        return it->second;
+    }
+
+    const auto index = static_cast<u32>(_scopes.size());
+    _scopes.push_back({ key, {}, 0 });
+    _scopeIndices.emplace(key, index);
+    return index;
+}
@@ -0,0 +1,102 @@
+#pragma once
+
+#include "types.hpp"
+
+#include <glad/glad.h>
+
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+struct GpuProfilerStatistics
+{
+    std::string Name;
+    f32 LastMilliseconds;
+    f32 MinMilliseconds;
+    f32 AverageMilliseconds;
+    f32 P99Milliseconds;
+    u32 SampleCount;
+};
+
+// Times debug group scopes on the gpu with GL_TIMESTAMP queries. Queries of a frame are read
+// back frameDepth frames later when they are long finished, so collecting never stalls. Each
+// scope keeps a rolling window of its latest historySize samples.
+class GpuProfiler final
+{
+public:
+    explicit GpuProfiler(const u32 frameDepth = 3, const u32 historySize = 240);
+    ~GpuProfiler();
+
+    GpuProfiler(const GpuProfiler&) = delete;
+    GpuProfiler& operator=(const GpuProfiler&) = delete;
+
+    void BeginFrame();
+    void EndFrame();
+
+    // also pushes and pops the matching debug group
+    void PushScope(const u32 id, const std::string_view name);
+    void PopScope();
+
+    [[nodiscard]] std::vector<GpuProfilerStatistics> Statistics() const;
+    // most recent sample of the named scope, 0 when it has none yet
+    [[nodiscard]] f32 LatestMilliseconds(const std::string_view name) const;
+
+    void ExportCsv(const std::filesystem::path& filePath) const;
+    void ExportJson(const std::filesystem::path& filePath) const;
+
+private:
+    struct ScopeQuery
+    {
+        u32 ScopeIndex;
+        u32 BeginQuery;
+        u32 EndQuery;
+    };
+
+    struct FrameQueries
+    {
+        std::vector<u32> Queries;
+        std::vector<ScopeQuery> Scopes;
+        u32 UsedQueryCount;
+    };
+
+    struct ScopeHistory
+    {
+        std::string Name;
+        std::vector<f32> Samples;
+        u32 NextSample;
+    };
+
+    [[nodiscard]] u32 AcquireQuery(FrameQueries& frame);
+    void Collect(FrameQueries& frame);
+    [[nodiscard]] u32 ScopeIndex(const std::string_view name);
+
+    std::vector<FrameQueries> _frames;
+    std::vector<u32> _openScopes;
+    std::vector<ScopeHistory> _scopes;
+    std::unordered_map<std::string, u32> _scopeIndices;
+    u32 _historySize{};
+    u64 _frameIndex{};
+};
+
+class GpuProfileScope final
+{
+public:
+    GpuProfileScope(GpuProfiler& profiler, const u32 id, const std::string_view name)
+        : _profiler{ profiler }
+    {
+        _profiler.PushScope(id, name);
+    }
+
+    ~GpuProfileScope()
+    {
+        _profiler.PopScope();
+    }
+
+    GpuProfileScope(const GpuProfileScope&) = delete;
+    GpuProfileScope& operator=(const GpuProfileScope&) = delete;
+
+private:
+    GpuProfiler& _profiler;
+};
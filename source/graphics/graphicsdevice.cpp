@@ -3,10 +3,21 @@
 #include "graphics/texturecube.hpp"
 #include "graphics/framebuffer.hpp"
 #include "graphics/program.hpp"
+#include "graphics/programbinarycache.hpp"
+#include "profiling/cpuprofiler.hpp"
 
+#include <GLFW/glfw3.h>
+
+#include <cstring>
 #include <sstream>
 #include <iostream>
 
+// GL_KHR_parallel_shader_compile and GL_ARB_parallel_shader_compile, glad is generated without extensions
+#ifndef GL_MAX_SHADER_COMPILER_THREADS_KHR
+#define GL_MAX_SHADER_COMPILER_THREADS_KHR 0x91B0
+#endif
+using PFNGLMAXSHADERCOMPILERTHREADSPROC = void (APIENTRY*)(GLuint count);
+
 #if _DEBUG
 void APIENTRY DebugCallback(
     const u32 source,
@@ -143,10 +154,49 @@ GraphicsDevice::GraphicsDevice()
     glEnable(GL_DEPTH_TEST);
     glEnable(GL_PROGRAM_POINT_SIZE);
     glEnable(GL_TEXTURE_CUBE_MAP_SEAMLESS);
+
+    EnableParallelShaderCompile();
+
+    _programBinaryCache = new ProgramBinaryCache("cache/programs");
+}
+
+void GraphicsDevice::EnableParallelShaderCompile()
+{
+    auto extensionCount = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &extensionCount);
+
+    PFNGLMAXSHADERCOMPILERTHREADSPROC maxShaderCompilerThreads = nullptr;
+    for (auto i = 0; i < extensionCount && maxShaderCompilerThreads == nullptr; i++)
+    {
+        const auto extension = reinterpret_cast<const char*>(glGetStringi(GL_EXTENSIONS, static_cast<u32>(i)));
+        if (std::strcmp(extension, "GL_KHR_parallel_shader_compile") == 0)
+        {
+            maxShaderCompilerThreads = reinterpret_cast<PFNGLMAXSHADERCOMPILERTHREADSPROC>(glfwGetProcAddress("glMaxShaderCompilerThreadsKHR"));
+        }
+        else if (std::strcmp(extension, "GL_ARB_parallel_shader_compile") == 0)
+        {
+            maxShaderCompilerThreads = reinterpret_cast<PFNGLMAXSHADERCOMPILERTHREADSPROC>(glfwGetProcAddress("glMaxShaderCompilerThreadsARB"));
+        }
+    }
+
+    if (maxShaderCompilerThreads == nullptr)
+    {
+        std::clog << "GL: Parallel shader compile not available, compiling synchronously.\n";
+        return;
+    }
+
+    // 0xFFFFFFFF lets the driver pick the number of threads
+    maxShaderCompilerThreads(0xFFFFFFFF);
+    Program::SetParallelCompileSupported(true);
+
+    auto threadCount = 0;
+    glGetIntegerv(GL_MAX_SHADER_COMPILER_THREADS_KHR, &threadCount);
+    std::clog << "GL: Parallel shader compile enabled, MAX_SHADER_COMPILER_THREADS = " << threadCount << '\n';
 }
 
 GraphicsDevice::~GraphicsDevice()
 {
+    delete _programBinaryCache;
 }
 
 Texture* GraphicsDevice::CreateTexture(
@@ -186,7 +236,18 @@ Framebuffer* GraphicsDevice::CreateFramebuffer(
 Program* GraphicsDevice::CreateProgramFromFiles(
         const std::string_view label,
         const std::string_view vertexShaderFilePath,
-        const std::string_view fragmentShaderFilePath)
+        const std::string_view fragmentShaderFilePath,
+        const std::vector<std::string>& features)
+{
+    PROFILE_SCOPE("GraphicsDevice::CreateProgramFromFiles");
+    return new Program(label, vertexShaderFilePath, fragmentShaderFilePath, _programBinaryCache, features);
+}
+
+Program* GraphicsDevice::CreateComputeProgramFromFile(
+        const std::string_view label,
+        const std::string_view computeShaderFilePath,
+        const std::vector<std::string>& features)
 {
-    return new Program(label, vertexShaderFilePath, fragmentShaderFilePath);
+    PROFILE_SCOPE("GraphicsDevice::CreateComputeProgramFromFile");
+    return new Program(label, computeShaderFilePath, _programBinaryCache, features);
 }
\ No newline at end of file
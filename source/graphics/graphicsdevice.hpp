@@ -6,6 +6,7 @@
 #include <stb_image.h>
 
 #include <array>
+#include <string>
 #include <string_view>
 #include <vector>
 
@@ -13,6 +14,7 @@ class Framebuffer;
 class Texture;
 class TextureCube;
 class Program;
+class ProgramBinaryCache;
 
 class GraphicsDevice final
 {
@@ -45,7 +47,15 @@ public:
     Program* CreateProgramFromFiles(
         const std::string_view label,
         const std::string_view vertexShaderFilePath,
-        const std::string_view fragmentShaderFilePath);
+        const std::string_view fragmentShaderFilePath,
+        const std::vector<std::string>& features = {});
+
+    Program* CreateComputeProgramFromFile(
+        const std::string_view label,
+        const std::string_view computeShaderFilePath,
+        const std::vector<std::string>& features = {});
 private:
+    void EnableParallelShaderCompile();
 
+    ProgramBinaryCache* _programBinaryCache{ nullptr };
 };
@@ -0,0 +1,237 @@
+#include "graphics/hierarchicalzbuffer.hpp"
+#include "graphics/program.hpp"
+#include "graphics/textures.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+static s32 PreviousPowerOfTwo(const s32 value)
+{
+    auto result = 1;
+    while (result * 2 <= value)
+    {
+        result *= 2;
+    }
+
+    return result;
+}
+
+HierarchicalZBuffer::HierarchicalZBuffer(Program& buildProgram, const s32 depthWidth, const s32 depthHeight)
+    : _buildProgram{ buildProgram }
+{
+    // power of two dimensions turn every level after the first into an exact 2x2 reduction
+    _width = PreviousPowerOfTwo(depthWidth);
+    _height = PreviousPowerOfTwo(depthHeight);
+    _levelCount = static_cast<u32>(std::log2(std::max(_width, _height))) + 1;
+
+    glCreateTextures(GL_TEXTURE_2D, 1, &_texture);
+    glTextureStorage2D(_texture, static_cast<s32>(_levelCount), GL_R32F, _width, _height);
+    glTextureParameteri(_texture, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+    glTextureParameteri(_texture, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTextureParameteri(_texture, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTextureParameteri(_texture, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    constexpr std::string_view label = "T_HZB";
+    glObjectLabel(GL_TEXTURE, _texture, static_cast<GLsizei>(label.length()), label.data());
+
+    // the cpu only gets a coarse level, enough to reject objects and lights hidden behind large occluders
+    auto constexpr maxReadbackWidth = 64;
+    while (_readbackLevel + 1 < _levelCount && (_width >> _readbackLevel) > maxReadbackWidth)
+    {
+        _readbackLevel++;
+    }
+    _readbackWidth = std::max(1, _width >> _readbackLevel);
+    _readbackHeight = std::max(1, _height >> _readbackLevel);
+
+    const auto readbackSize = static_cast<GLsizeiptr>(_readbackWidth * _readbackHeight * sizeof(f32));
+    for (auto& readback : _readbacks)
+    {
+        glCreateBuffers(1, &readback.Buffer);
+        glNamedBufferStorage(readback.Buffer, readbackSize, nullptr, GL_MAP_READ_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT);
+        readback.Data = static_cast<f32*>(glMapNamedBufferRange(readback.Buffer, 0, readbackSize, GL_MAP_READ_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT));
+    }
+    _readbackDepth.resize(static_cast<std::size_t>(_readbackWidth * _readbackHeight));
+}
+
+HierarchicalZBuffer::~HierarchicalZBuffer()
+{
+    for (auto& readback : _readbacks)
+    {
+        if (readback.Fence != nullptr)
+        {
+            glDeleteSync(readback.Fence);
+        }
+        glUnmapNamedBuffer(readback.Buffer);
+        glDeleteBuffers(1, &readback.Buffer);
+    }
+
+    glDeleteTextures(1, &_texture);
+}
+
+void HierarchicalZBuffer::Build(const Texture& depthTexture, const glm::ivec2& depthSize, const glm::mat4& viewProjection)
+{
+    auto constexpr kUniformLevel = 0;
+    auto constexpr kUniformDestinationSize = 1;
+    auto constexpr kUniformDepthSize = 2;
+    auto constexpr kWorkGroupSize = 8;
+
+    _buildProgram.Bind();
+    depthTexture.Bind(0);
+    _buildProgram.SetComputeShaderUniform(kUniformDepthSize, depthSize);
+
+    for (u32 level = 0; level < _levelCount; level++)
+    {
+        const auto levelWidth = std::max(1, _width >> level);
+        const auto levelHeight = std::max(1, _height >> level);
+
+        if (level > 0)
+        {
+            glBindImageTexture(0, _texture, static_cast<s32>(level - 1), GL_FALSE, 0, GL_READ_ONLY, GL_R32F);
+        }
+        glBindImageTexture(1, _texture, static_cast<s32>(level), GL_FALSE, 0, GL_WRITE_ONLY, GL_R32F);
+
+        _buildProgram.SetComputeShaderUniform(kUniformLevel, static_cast<s32>(level));
+        _buildProgram.SetComputeShaderUniform(kUniformDestinationSize, glm::ivec2(levelWidth, levelHeight));
+
+        glDispatchCompute((levelWidth + kWorkGroupSize - 1) / kWorkGroupSize, (levelHeight + kWorkGroupSize - 1) / kWorkGroupSize, 1);
+        glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+    }
+    glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT | GL_PIXEL_BUFFER_BARRIER_BIT);
+
+    _viewProjection = viewProjection;
+    _isValid = true;
+
+    auto& readback = _readbacks[_readbackIndex];
+    if (readback.Fence != nullptr)
+    {
+        // the cpu did not get to this one yet, drop it in favour of the newer data
+        glDeleteSync(readback.Fence);
+    }
+
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.Buffer);
+    glGetTextureImage(_texture, static_cast<s32>(_readbackLevel), GL_RED, GL_FLOAT, _readbackWidth * _readbackHeight * static_cast<s32>(sizeof(f32)), nullptr);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    readback.Fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    readback.ViewProjection = viewProjection;
+    _readbackIndex = (_readbackIndex + 1) % static_cast<u32>(_readbacks.size());
+}
+
+void HierarchicalZBuffer::UpdateReadback()
+{
+    // oldest slot first, so the newest finished readback ends up being the one used
+    for (std::size_t i = 0; i < _readbacks.size(); i++)
+    {
+        auto& readback = _readbacks[(_readbackIndex + i) % _readbacks.size()];
+        if (readback.Fence == nullptr)
+        {
+            continue;
+        }
+
+        const auto waitResult = glClientWaitSync(readback.Fence, 0, 0);
+        if (waitResult != GL_ALREADY_SIGNALED && waitResult != GL_CONDITION_SATISFIED)
+        {
+            continue;
+        }
+
+        glDeleteSync(readback.Fence);
+        readback.Fence = nullptr;
+
+        std::memcpy(_readbackDepth.data(), readback.Data, _readbackDepth.size() * sizeof(f32));
+        _readbackViewProjection = readback.ViewProjection;
+        _isReadbackValid = true;
+    }
+}
+
+void HierarchicalZBuffer::Bind(const u32 textureUnit) const
+{
+    glBindTextureUnit(textureUnit, _texture);
+}
+
+bool HierarchicalZBuffer::IsValid() const
+{
+    return _isValid;
+}
+
+bool HierarchicalZBuffer::IsReadbackValid() const
+{
+    return _isReadbackValid;
+}
+
+const glm::mat4& HierarchicalZBuffer::ViewProjection() const
+{
+    return _viewProjection;
+}
+
+glm::vec2 HierarchicalZBuffer::Size() const
+{
+    return glm::vec2(static_cast<f32>(_width), static_cast<f32>(_height));
+}
+
+u32 HierarchicalZBuffer::LevelCount() const
+{
+    return _levelCount;
+}
+
+bool HierarchicalZBuffer::IsBoxVisible(const BoundingBox& box) const
+{
+    if (!_isReadbackValid)
+    {
+        return true;
+    }
+
+    auto minUv = glm::vec2(1.0f);
+    auto maxUv = glm::vec2(0.0f);
+    auto minDepth = 1.0f;
+    for (auto corner = 0; corner < 8; corner++)
+    {
+        const auto position = glm::vec3(
+            (corner & 1) ? box.Max.x : box.Min.x,
+            (corner & 2) ? box.Max.y : box.Min.y,
+            (corner & 4) ? box.Max.z : box.Min.z);
+        const auto clipPosition = _readbackViewProjection * glm::vec4(position, 1.0f);
+
+        // boxes reaching behind the camera are not worth the trouble
+        if (clipPosition.w <= 0.0f)
+        {
+            return true;
+        }
+
+        const auto ndc = glm::vec3(clipPosition) / clipPosition.w;
+        const auto uv = glm::vec2(ndc.x, ndc.y) * 0.5f + 0.5f;
+        minUv = glm::min(minUv, uv);
+        maxUv = glm::max(maxUv, uv);
+        minDepth = std::min(minDepth, ndc.z * 0.5f + 0.5f);
+    }
+
+    minUv = glm::clamp(minUv, 0.0f, 1.0f);
+    maxUv = glm::clamp(maxUv, 0.0f, 1.0f);
+    if (minUv.x >= maxUv.x || minUv.y >= maxUv.y)
+    {
+        // fully off screen, that is the frustum's call to make
+        return true;
+    }
+
+    const auto minTexelX = std::min(static_cast<s32>(minUv.x * static_cast<f32>(_readbackWidth)), _readbackWidth - 1);
+    const auto minTexelY = std::min(static_cast<s32>(minUv.y * static_cast<f32>(_readbackHeight)), _readbackHeight - 1);
+    const auto maxTexelX = std::min(static_cast<s32>(maxUv.x * static_cast<f32>(_readbackWidth)), _readbackWidth - 1);
+    const auto maxTexelY = std::min(static_cast<s32>(maxUv.y * static_cast<f32>(_readbackHeight)), _readbackHeight - 1);
+
+    for (auto y = minTexelY; y <= maxTexelY; y++)
+    {
+        for (auto x = minTexelX; x <= maxTexelX; x++)
+        {
+            if (minDepth <= _readbackDepth[static_cast<std::size_t>(y * _readbackWidth + x)])
+            {
+                return true;
+            }
+        }
+    }
+
+    return false;
+}
+
+bool HierarchicalZBuffer::IsSphereVisible(const glm::vec3& center, const f32 radius) const
+{
+    return IsBoxVisible(BoundingBox{ center - glm::vec3(radius), center + glm::vec3(radius) });
+}
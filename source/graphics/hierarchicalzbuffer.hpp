@@ -0,0 +1,68 @@
+#pragma once
+
+#include "types.hpp"
+#include "math/bounds.hpp"
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <array>
+#include <vector>
+
+class Program;
+class Texture;
+
+// Max depth pyramid built from the depth buffer of a finished frame. The following frame tests
+// bounds against it using the view projection of the frame the pyramid was built from: instances
+// on the gpu via Bind, the object and light lists on the cpu via a small asynchronous readback.
+class HierarchicalZBuffer final
+{
+public:
+    HierarchicalZBuffer(Program& buildProgram, const s32 depthWidth, const s32 depthHeight);
+    ~HierarchicalZBuffer();
+
+    // depthSize is the rendered part of depthTexture, starting at its origin
+    void Build(const Texture& depthTexture, const glm::ivec2& depthSize, const glm::mat4& viewProjection);
+
+    // picks up the most recent finished readback, never waits for the gpu
+    void UpdateReadback();
+
+    void Bind(const u32 textureUnit) const;
+
+    [[nodiscard]] bool IsValid() const;
+    [[nodiscard]] bool IsReadbackValid() const;
+    [[nodiscard]] const glm::mat4& ViewProjection() const;
+    [[nodiscard]] glm::vec2 Size() const;
+    [[nodiscard]] u32 LevelCount() const;
+
+    [[nodiscard]] bool IsBoxVisible(const BoundingBox& box) const;
+    [[nodiscard]] bool IsSphereVisible(const glm::vec3& center, const f32 radius) const;
+
+private:
+    struct Readback
+    {
+        u32 Buffer{};
+        f32* Data{};
+        GLsync Fence{};
+        glm::mat4 ViewProjection{ 1.0f };
+    };
+
+    Program& _buildProgram;
+
+    u32 _texture{};
+    s32 _width{};
+    s32 _height{};
+    u32 _levelCount{};
+    bool _isValid{ false };
+    glm::mat4 _viewProjection{ 1.0f };
+
+    u32 _readbackLevel{};
+    s32 _readbackWidth{};
+    s32 _readbackHeight{};
+    std::array<Readback, 2> _readbacks{};
+    u32 _readbackIndex{};
+
+    std::vector<f32> _readbackDepth;
+    glm::mat4 _readbackViewProjection{ 1.0f };
+    bool _isReadbackValid{ false };
+};
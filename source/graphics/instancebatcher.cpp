@@ -0,0 +1,59 @@
+#include "graphics/instancebatcher.hpp"
+
+void InstanceBatcher::Begin()
+{
+    _batches.clear();
+    _worldMatrices.clear();
+    _previousMatrices.clear();
+}
+
+void InstanceBatcher::Add(
+    const u64 batchKey,
+    const u32 payload,
+    const glm::mat4& world,
+    const glm::mat4& modelViewProjectionPrevious)
+{
+    const auto instanceIndex = static_cast<u32>(_worldMatrices.size());
+    if (_batches.empty() || _batches.back().Key != batchKey)
+    {
+        _batches.push_back({ batchKey, instanceIndex, 0, payload });
+    }
+    _batches.back().InstanceCount++;
+
+    _worldMatrices.push_back(world);
+    _previousMatrices.push_back(modelViewProjectionPrevious);
+}
+
+void InstanceBatcher::Upload(FrameDataRing& frameDataRing)
+{
+    _worldMatrixAllocation = {};
+    _previousMatrixAllocation = {};
+    if (_worldMatrices.empty())
+    {
+        return;
+    }
+
+    _worldMatrixAllocation = frameDataRing.Write(_worldMatrices);
+    _previousMatrixAllocation = frameDataRing.Write(_previousMatrices);
+}
+
+void InstanceBatcher::Bind(const FrameDataRing& frameDataRing, const u32 worldMatricesBindingIndex, const u32 previousMatricesBindingIndex) const
+{
+    if (_worldMatrixAllocation.Size == 0)
+    {
+        return;
+    }
+
+    frameDataRing.BindAsStorageBuffer(worldMatricesBindingIndex, _worldMatrixAllocation);
+    frameDataRing.BindAsStorageBuffer(previousMatricesBindingIndex, _previousMatrixAllocation);
+}
+
+const std::vector<InstanceBatch>& InstanceBatcher::Batches() const
+{
+    return _batches;
+}
+
+u32 InstanceBatcher::InstanceCount() const
+{
+    return static_cast<u32>(_worldMatrices.size());
+}
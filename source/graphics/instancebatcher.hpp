@@ -0,0 +1,45 @@
+#pragma once
+
+#include "types.hpp"
+#include "graphics/framedataring.hpp"
+
+#include <glm/glm.hpp>
+
+#include <vector>
+
+struct InstanceBatch
+{
+    u64 Key;
+    u32 FirstInstance;
+    u32 InstanceCount;
+    // payload of the first object in the batch, used to look up the shared state
+    u32 Payload;
+};
+
+// Groups consecutive objects sharing a batch key into one instanced draw. Per instance world
+// matrices and previous frame model view projections are gathered on the cpu and uploaded
+// into the frame data ring, a batch reads them starting at FirstInstance.
+class InstanceBatcher final
+{
+public:
+    void Begin();
+    void Add(
+        const u64 batchKey,
+        const u32 payload,
+        const glm::mat4& world,
+        const glm::mat4& modelViewProjectionPrevious);
+    void Upload(FrameDataRing& frameDataRing);
+
+    void Bind(const FrameDataRing& frameDataRing, const u32 worldMatricesBindingIndex, const u32 previousMatricesBindingIndex) const;
+
+    [[nodiscard]] const std::vector<InstanceBatch>& Batches() const;
+    [[nodiscard]] u32 InstanceCount() const;
+
+private:
+    std::vector<InstanceBatch> _batches;
+    std::vector<glm::mat4> _worldMatrices;
+    std::vector<glm::mat4> _previousMatrices;
+
+    FrameDataAllocation _worldMatrixAllocation{};
+    FrameDataAllocation _previousMatrixAllocation{};
+};
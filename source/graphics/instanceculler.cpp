@@ -0,0 +1,95 @@
+#include "graphics/instanceculler.hpp"
+#include "graphics/buffer.hpp"
+#include "graphics/geometry.hpp"
+#include "graphics/hierarchicalzbuffer.hpp"
+#include "graphics/program.hpp"
+#include "math/frustum.hpp"
+
+#include <glad/glad.h>
+
+#include <vector>
+
+InstanceCuller::InstanceCuller(
+    Program& cullProgram,
+    const Buffer& instanceBuffer,
+    const u32 indexCount,
+    const f32 boundingRadius)
+    : _cullProgram{ cullProgram },
+    _instanceBuffer{ instanceBuffer },
+    _indexCount{ indexCount },
+    _instanceCount{ instanceBuffer.Size() },
+    _boundingRadius{ boundingRadius }
+{
+    _visibleInstanceBuffer = new Buffer(std::vector<u32>(_instanceCount, 0));
+    _drawCommandBuffer = new Buffer(std::vector<DrawElementsIndirectCommand>{ { _indexCount, 0, 0, 0, 0 } });
+}
+
+InstanceCuller::~InstanceCuller()
+{
+    delete _visibleInstanceBuffer;
+    delete _drawCommandBuffer;
+}
+
+void InstanceCuller::Cull(
+    const Frustum& frustum,
+    const glm::vec3& cameraPosition,
+    const f32 maxDistance,
+    const HierarchicalZBuffer* hierarchicalZBuffer) const
+{
+    auto constexpr kUniformFrustumPlanes = 0;
+    auto constexpr kUniformCameraPosition = 6;
+    auto constexpr kUniformMaxDistance = 7;
+    auto constexpr kUniformInstanceCount = 8;
+    auto constexpr kUniformBoundingRadius = 9;
+    auto constexpr kUniformIsOcclusionCullingEnabled = 10;
+    auto constexpr kUniformHzbViewProjection = 11;
+    auto constexpr kUniformHzbSize = 12;
+    auto constexpr kUniformHzbLevelCount = 13;
+    auto constexpr kWorkGroupSize = 64u;
+
+    // reset the instance count, the count itself is only ever consumed by the gpu
+    const DrawElementsIndirectCommand drawCommand{ _indexCount, 0, 0, 0, 0 };
+    glNamedBufferSubData(_drawCommandBuffer->Id(), 0, sizeof(DrawElementsIndirectCommand), &drawCommand);
+
+    _instanceBuffer.BindAsStorageBuffer(0);
+    _visibleInstanceBuffer->BindAsStorageBuffer(1);
+    _drawCommandBuffer->BindAsStorageBuffer(2);
+
+    for (auto side = 0; side < 6; side++)
+    {
+        _cullProgram.SetComputeShaderUniform(kUniformFrustumPlanes + side, frustum.Plane(side));
+    }
+    _cullProgram.SetComputeShaderUniform(kUniformCameraPosition, cameraPosition);
+    _cullProgram.SetComputeShaderUniform(kUniformMaxDistance, maxDistance);
+    _cullProgram.SetComputeShaderUniform(kUniformInstanceCount, _instanceCount);
+    _cullProgram.SetComputeShaderUniform(kUniformBoundingRadius, _boundingRadius);
+
+    const auto isOcclusionCullingEnabled = hierarchicalZBuffer != nullptr && hierarchicalZBuffer->IsValid();
+    _cullProgram.SetComputeShaderUniform(kUniformIsOcclusionCullingEnabled, isOcclusionCullingEnabled);
+    if (isOcclusionCullingEnabled)
+    {
+        hierarchicalZBuffer->Bind(0);
+        _cullProgram.SetComputeShaderUniform(kUniformHzbViewProjection, hierarchicalZBuffer->ViewProjection());
+        _cullProgram.SetComputeShaderUniform(kUniformHzbSize, hierarchicalZBuffer->Size());
+        _cullProgram.SetComputeShaderUniform(kUniformHzbLevelCount, static_cast<s32>(hierarchicalZBuffer->LevelCount()));
+    }
+    _cullProgram.Bind();
+
+    glDispatchCompute((_instanceCount + kWorkGroupSize - 1) / kWorkGroupSize, 1, 1);
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_COMMAND_BARRIER_BIT);
+}
+
+void InstanceCuller::BindVisibleInstances(const u32 bindingIndex) const
+{
+    _visibleInstanceBuffer->BindAsStorageBuffer(bindingIndex);
+}
+
+const Buffer& InstanceCuller::DrawCommandBuffer() const
+{
+    return *_drawCommandBuffer;
+}
+
+u32 InstanceCuller::InstanceCount() const
+{
+    return _instanceCount;
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include "types.hpp"
+
+#include <glm/glm.hpp>
+
+class Buffer;
+class Frustum;
+class HierarchicalZBuffer;
+class Program;
+
+// Culls a buffer of instance world matrices on the gpu and produces a compacted list
+// of visible instance indices plus the indirect draw command to render them
+class InstanceCuller final
+{
+public:
+    InstanceCuller(
+        Program& cullProgram,
+        const Buffer& instanceBuffer,
+        const u32 indexCount,
+        const f32 boundingRadius);
+    ~InstanceCuller();
+
+    // hierarchicalZBuffer is optional, without one instances are only frustum and distance culled
+    void Cull(
+        const Frustum& frustum,
+        const glm::vec3& cameraPosition,
+        const f32 maxDistance,
+        const HierarchicalZBuffer* hierarchicalZBuffer = nullptr) const;
+    void BindVisibleInstances(const u32 bindingIndex) const;
+
+    [[nodiscard]] const Buffer& DrawCommandBuffer() const;
+    [[nodiscard]] u32 InstanceCount() const;
+
+private:
+    Program& _cullProgram;
+    const Buffer& _instanceBuffer;
+    Buffer* _visibleInstanceBuffer{};
+    Buffer* _drawCommandBuffer{};
+
+    u32 _indexCount{};
+    u32 _instanceCount{};
+    f32 _boundingRadius{};
+};
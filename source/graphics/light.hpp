@@ -30,3 +30,15 @@ struct Light
 	{
 	}
 };
+
+// std430 layout of a light as the light pass reads it from its storage buffer
+struct LightData
+{
+	glm::mat4 Model;
+	glm::vec4 Position;
+	glm::vec4 Color;
+	glm::vec4 Direction;
+	glm::vec4 Attenuation;
+	glm::vec4 CutOff;
+	glm::ivec4 Type;
+};
\ No newline at end of file
@@ -7,4 +7,14 @@ void Material::Apply() const
     glBindTextureUnit(0, _textureDiffuse->Id());
     glBindTextureUnit(1, _textureSpecular->Id());
     glBindTextureUnit(2, _textureNormal->Id());
-}
\ No newline at end of file
+}
+void Material::ReplaceTexture(const Texture* previous, Texture* texture)
+{
+    for (auto slot : { &_textureDiffuse, &_textureNormal, &_textureSpecular })
+    {
+        if (*slot == previous)
+        {
+            *slot = texture;
+        }
+    }
+}
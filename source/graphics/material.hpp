@@ -26,7 +26,18 @@ public:
     
     void Apply() const;
 
+    // points every slot using previous at texture instead, used when a texture is reloaded
+    void ReplaceTexture(const Texture* previous, Texture* texture);
+
+    [[nodiscard]] u32 Id() const
+    {
+        return _id;
+    }
+
 private:
+    inline static u32 _nextId{ 0 };
+    u32 _id{ _nextId++ };
+
     Texture* _textureDiffuse{};
     Texture* _textureNormal{};
     Texture* _textureSpecular{};
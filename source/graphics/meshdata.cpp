@@ -2,6 +2,7 @@
 #include "graphics/buffer.hpp"
 #include "graphics/meshdata.hpp"
 #include "graphics/geometry.hpp"
+#include "profiling/cpuprofiler.hpp"
 
 #include <assimp/Importer.hpp>
 #include <assimp/postprocess.h>
@@ -9,6 +10,7 @@
 
 MeshData* MeshData::FromFile(const std::filesystem::path& filePath)
 {
+    PROFILE_SCOPE("MeshData::FromFile");
     auto meshData = new MeshData();
     Assimp::Importer importer;
 
@@ -243,4 +245,21 @@ void MeshData::CalculateTangents()
             : 1.0f;
         _realTangents.emplace_back(realTangent, realBitangent);
     }
+}
+
+BoundingBox MeshData::CalculateBounds() const
+{
+    if (_positions.empty())
+    {
+        return BoundingBox{};
+    }
+
+    BoundingBox bounds{ _positions[0], _positions[0] };
+    for (const auto& position : _positions)
+    {
+        bounds.Min = glm::min(bounds.Min, position);
+        bounds.Max = glm::max(bounds.Max, position);
+    }
+
+    return bounds;
 }
\ No newline at end of file
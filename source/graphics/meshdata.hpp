@@ -111,10 +111,11 @@ public:
 		const auto vertexBuffer = new Buffer(GL_ARRAY_BUFFER, vertices, GL_STATIC_DRAW);
 		const auto indexBuffer = new Buffer(GL_ELEMENT_ARRAY_BUFFER, indices, GL_STATIC_DRAW);
 
-		return new Geometry(*vertexBuffer, *indexBuffer, _vertexType);
+		return new Geometry(*vertexBuffer, *indexBuffer, _vertexType, CalculateBounds());
 	}
 private:
 	void CalculateTangents();
+	[[nodiscard]] BoundingBox CalculateBounds() const;
 
 	std::vector<glm::vec3> _positions;
 	std::vector<glm::vec3> _colors;
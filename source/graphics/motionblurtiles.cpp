@@ -0,0 +1,71 @@
+#include "graphics/motionblurtiles.hpp"
+#include "graphics/program.hpp"
+#include "graphics/textures.hpp"
+
+#include <string_view>
+
+static u32 CreateTileTexture(const s32 width, const s32 height, const std::string_view label)
+{
+    u32 texture{};
+    glCreateTextures(GL_TEXTURE_2D, 1, &texture);
+    glTextureStorage2D(texture, 1, GL_RG16F, width, height);
+    glTextureParameteri(texture, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTextureParameteri(texture, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTextureParameteri(texture, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTextureParameteri(texture, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glObjectLabel(GL_TEXTURE, texture, static_cast<GLsizei>(label.length()), label.data());
+    return texture;
+}
+
+MotionBlurTiles::MotionBlurTiles(
+    Program& tileMaxProgram,
+    Program& neighborMaxProgram,
+    const s32 targetWidth,
+    const s32 targetHeight)
+    : _tileMaxProgram{ tileMaxProgram },
+    _neighborMaxProgram{ neighborMaxProgram }
+{
+    const auto tileCountX = (targetWidth + TileSize - 1) / TileSize;
+    const auto tileCountY = (targetHeight + TileSize - 1) / TileSize;
+
+    _tileMaxTexture = CreateTileTexture(tileCountX, tileCountY, "T_MotionBlurTileMax");
+    _neighborMaxTexture = CreateTileTexture(tileCountX, tileCountY, "T_MotionBlurNeighborMax");
+}
+
+MotionBlurTiles::~MotionBlurTiles()
+{
+    glDeleteTextures(1, &_tileMaxTexture);
+    glDeleteTextures(1, &_neighborMaxTexture);
+}
+
+void MotionBlurTiles::Build(const Texture& velocityTexture, const glm::ivec2& renderSize, const f32 velocityScale)
+{
+    auto constexpr kUniformTileMaxVelocityScale = 0;
+    auto constexpr kUniformTileMaxRenderSize = 1;
+    auto constexpr kUniformTileMaxMaxVelocity = 2;
+    auto constexpr kUniformNeighborMaxTileCount = 0;
+    auto constexpr kWorkGroupSize = 8;
+
+    const auto tileCount = (renderSize + TileSize - 1) / TileSize;
+
+    _tileMaxProgram.Bind();
+    velocityTexture.Bind(0);
+    glBindImageTexture(0, _tileMaxTexture, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RG16F);
+    _tileMaxProgram.SetComputeShaderUniform(kUniformTileMaxVelocityScale, velocityScale);
+    _tileMaxProgram.SetComputeShaderUniform(kUniformTileMaxRenderSize, renderSize);
+    _tileMaxProgram.SetComputeShaderUniform(kUniformTileMaxMaxVelocity, MaxVelocity);
+    glDispatchCompute(tileCount.x, tileCount.y, 1);
+    glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+
+    _neighborMaxProgram.Bind();
+    glBindImageTexture(0, _tileMaxTexture, 0, GL_FALSE, 0, GL_READ_ONLY, GL_RG16F);
+    glBindImageTexture(1, _neighborMaxTexture, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RG16F);
+    _neighborMaxProgram.SetComputeShaderUniform(kUniformNeighborMaxTileCount, tileCount);
+    glDispatchCompute((tileCount.x + kWorkGroupSize - 1) / kWorkGroupSize, (tileCount.y + kWorkGroupSize - 1) / kWorkGroupSize, 1);
+    glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+}
+
+void MotionBlurTiles::BindNeighborMax(const u32 textureUnit) const
+{
+    glBindTextureUnit(textureUnit, _neighborMaxTexture);
+}
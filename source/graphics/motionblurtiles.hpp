@@ -0,0 +1,39 @@
+#pragma once
+
+#include "types.hpp"
+
+#include <glm/glm.hpp>
+
+class Program;
+class Texture;
+
+// Per tile velocity maxima for the reconstruction motion blur. The tile max pass reduces every
+// TileSize x TileSize block of the velocity buffer to its longest velocity, the neighbor max
+// pass widens that to the surrounding tiles, which bounds what can blur over any pixel of a tile.
+class MotionBlurTiles final
+{
+public:
+    // must match kTileSize and the work group size of the motion blur shaders
+    static constexpr s32 TileSize = 16;
+    // longest blur in pixels, anything longer would reach past the neighborhood of a tile
+    static constexpr f32 MaxVelocity = 2.0f * TileSize;
+
+    MotionBlurTiles(
+        Program& tileMaxProgram,
+        Program& neighborMaxProgram,
+        const s32 targetWidth,
+        const s32 targetHeight);
+    ~MotionBlurTiles();
+
+    // renderSize is the rendered part of velocityTexture, starting at its origin
+    void Build(const Texture& velocityTexture, const glm::ivec2& renderSize, const f32 velocityScale);
+
+    void BindNeighborMax(const u32 textureUnit) const;
+
+private:
+    Program& _tileMaxProgram;
+    Program& _neighborMaxProgram;
+
+    u32 _tileMaxTexture{};
+    u32 _neighborMaxTexture{};
+};
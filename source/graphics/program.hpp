@@ -8,7 +8,12 @@
 #include <glm/gtc/type_ptr.hpp>
 
 #include <array>
+#include <filesystem>
 #include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
 
 template <typename T>
 u32 CreateShaderStorageBuffer(T* data, const u32 size)
@@ -25,17 +30,48 @@ u32 CreateShaderStorageBuffer(T* data, const u32 size)
     return name;
 }
 
+class ProgramBinaryCache;
+
 class Program
 {
 public:
     [[nodiscard]] u32 GetId() const;
 
+    // features are defined as 1 or 0 after #version, depending on the selected permutation
     Program(
         const std::string_view label,
         const std::string_view vertexShaderFilePath,
-        const std::string_view fragmentShaderFilePath);
+        const std::string_view fragmentShaderFilePath,
+        const ProgramBinaryCache* binaryCache = nullptr,
+        const std::vector<std::string>& features = {});
+    Program(
+        const std::string_view label,
+        const std::string_view computeShaderFilePath,
+        const ProgramBinaryCache* binaryCache = nullptr,
+        const std::vector<std::string>& features = {});
     ~Program();
 
+    // bit i enables features[i]. Variants are compiled on first use and kept, uniforms and Bind
+    // apply to the selected one
+    void SetPermutation(const u32 permutation);
+    [[nodiscard]] u32 Permutation() const;
+    // starts compiling a variant without selecting it, so it is ready by the time it is needed
+    void Prepare(const u32 permutation);
+
+    // true once the selected variant compiled and linked successfully, never waits when the driver compiles in
+    // the background. Passes skip their work until then, Bind waits for it instead. After a Reload
+    // the previous version stands in until the new one is done
+    [[nodiscard]] bool IsReady();
+
+    // true when filePath is one of the stage sources or a file they include
+    [[nodiscard]] bool DependsOn(const std::filesystem::path& filePath) const;
+    // recompiles every variant from the files on disk. Until a new variant has compiled, and when it
+    // fails to, the previous one stays in use
+    bool Reload();
+
+    // set by the graphics device when GL_KHR_parallel_shader_compile or the ARB variant is available
+    static void SetParallelCompileSupported(const bool isSupported);
+
     template <typename T>
     void SetFragmentShaderUniform(s32 location, T const& value)
     {
@@ -47,8 +83,14 @@ public:
     {
         SetProgramUniform(_vertexShader, location, value);
     }
+
+    template <typename T>
+    void SetComputeShaderUniform(s32 location, T const& value)
+    {
+        SetProgramUniform(_computeShader, location, value);
+    }
         
-    void Bind() const;
+    void Bind();
     
 private:
     template <typename T>
@@ -125,9 +167,68 @@ private:
         else throw std::runtime_error("unsupported type");
     }
 
+    // a separable program of one stage, the shader object lives until the link has finished
+    struct StageProgram
+    {
+        u32 Program;
+        u32 Shader;
+        u64 Key;
+        bool IsComplete;
+        bool IsValid;
+    };
+
+    struct Stage
+    {
+        u32 Type;
+        std::string FilePath;
+        std::string Source;
+        // features the source mentions, permutations differing only in other bits share a program
+        u32 FeatureMask;
+        // the stage source and everything it includes, normalized
+        std::unordered_set<std::string> Files;
+        std::unordered_map<u32, StageProgram> Programs;
+    };
+
+    struct Variant
+    {
+        u32 Pipeline;
+        u32 VertexShader;
+        u32 FragmentShader;
+        u32 ComputeShader;
+        bool IsComplete;
+        bool IsValid;
+    };
+
+    [[nodiscard]] Stage LoadStage(const u32 type, const std::string_view filePath) const;
+    void Select(const Variant& variant);
+    void ReleaseRetired();
+    Variant& GetOrCreateVariant(const u32 permutation);
+    StageProgram& GetOrCreateStageProgram(Stage& stage, const u32 permutation);
+    // finishes the variant if all of its stages are done, or waits for them when wait is set
+    bool CompleteVariant(Variant& variant, const u32 permutation, const bool wait);
+
+    static std::string ExpandIncludes(const std::filesystem::path& filePath, std::unordered_set<std::string>& includedFiles);
+    static std::string InjectDefines(const std::string& source, const std::vector<std::string>& features, const u32 featureMask, const u32 permutation);
+    static StageProgram BeginShaderProgram(const u32 stage, const std::string& source, const ProgramBinaryCache* binaryCache);
+    static bool IsShaderProgramComplete(const StageProgram& stageProgram);
+    static void FinishShaderProgram(StageProgram& stageProgram, const std::string_view filePath, const ProgramBinaryCache* binaryCache);
     static void ValidateProgram(const u32 shader, const std::string_view filename);
 
+    static inline bool _isParallelCompileSupported{ false };
+
+    std::string _label;
+    const ProgramBinaryCache* _binaryCache{};
+    std::vector<std::string> _features;
+    std::vector<Stage> _stages;
+    std::unordered_map<u32, Variant> _variants;
+    // what the last Reload replaced, kept as a fallback while the new variants compile
+    std::vector<Stage> _retiredStages;
+    std::unordered_map<u32, Variant> _retiredVariants;
+    u32 _permutation{ ~0u };
+
+    // the selected variant
     u32 _pipeline{};
     u32 _vertexShader{};
     u32 _fragmentShader{};
+    u32 _computeShader{};
 };
@@ -0,0 +1,169 @@
+#include "graphics/programbinarycache.hpp"
+
+#include <glad/glad.h>
+
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+namespace
+{
+    constexpr u32 kMagic = 0x42505345; // "ESPB"
+    constexpr u32 kVersion = 1;
+
+    struct EntryHeader
+    {
+        u32 Magic;
+        u32 Version;
+        u32 BinaryFormat;
+        u32 BinaryLength;
+    };
+
+    u64 Fnv1a(const void* data, const std::size_t size, u64 hash = 14695981039346656037ull)
+    {
+        const auto bytes = static_cast<const unsigned char*>(data);
+        for (std::size_t i = 0; i < size; i++)
+        {
+            hash ^= bytes[i];
+            hash *= 1099511628211ull;
+        }
+
+        return hash;
+    }
+
+    std::string GetString(const u32 name)
+    {
+        const auto value = reinterpret_cast<const char*>(glGetString(name));
+        return value != nullptr ? value : "";
+    }
+}
+
+ProgramBinaryCache::ProgramBinaryCache(std::filesystem::path directory)
+    : _directory{ std::move(directory) }
+{
+    auto binaryFormatCount = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &binaryFormatCount);
+    if (binaryFormatCount == 0)
+    {
+        std::clog << "ProgramBinaryCache: Driver offers no program binary formats, shaders are compiled on every start\n";
+        return;
+    }
+
+    std::error_code error;
+    std::filesystem::create_directories(_directory, error);
+    if (error)
+    {
+        std::clog << "ProgramBinaryCache: Unable to create " << _directory.string() << ", " << error.message() << '\n';
+        return;
+    }
+
+    _driver = GetString(GL_VENDOR) + '\n' + GetString(GL_RENDERER) + '\n' + GetString(GL_VERSION);
+    _isEnabled = true;
+}
+
+bool ProgramBinaryCache::IsEnabled() const
+{
+    return _isEnabled;
+}
+
+u64 ProgramBinaryCache::Key(const u32 stage, const std::string_view source) const
+{
+    auto hash = Fnv1a(&kVersion, sizeof(kVersion));
+    hash = Fnv1a(&stage, sizeof(stage), hash);
+    hash = Fnv1a(_driver.data(), _driver.size(), hash);
+    return Fnv1a(source.data(), source.size(), hash);
+}
+
+u32 ProgramBinaryCache::Load(const u64 key) const
+{
+    if (!_isEnabled)
+    {
+        return 0;
+    }
+
+    std::ifstream file(EntryPath(key), std::ios::binary);
+    if (!file)
+    {
+        return 0;
+    }
+
+    EntryHeader header{};
+    file.read(reinterpret_cast<char*>(&header), sizeof(header));
+    if (!file || header.Magic != kMagic || header.Version != kVersion || header.BinaryLength == 0)
+    {
+        return 0;
+    }
+
+    std::vector<char> binary(header.BinaryLength);
+    file.read(binary.data(), static_cast<std::streamsize>(binary.size()));
+    if (!file)
+    {
+        return 0;
+    }
+
+    const auto program = glCreateProgram();
+    glProgramParameteri(program, GL_PROGRAM_SEPARABLE, GL_TRUE);
+    glProgramBinary(program, header.BinaryFormat, binary.data(), static_cast<GLsizei>(binary.size()));
+
+    auto linked = 0;
+    glGetProgramiv(program, GL_LINK_STATUS, &linked);
+    if (linked == GL_FALSE)
+    {
+        // drivers may reject binaries at any time, the caller compiles from source instead
+        std::clog << "ProgramBinaryCache: Driver rejected " << EntryPath(key).string() << '\n';
+        glDeleteProgram(program);
+        return 0;
+    }
+
+    return program;
+}
+
+void ProgramBinaryCache::Store(const u64 key, const u32 program) const
+{
+    if (!_isEnabled)
+    {
+        return;
+    }
+
+    auto binaryLength = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &binaryLength);
+    if (binaryLength <= 0)
+    {
+        return;
+    }
+
+    std::vector<char> binary(static_cast<std::size_t>(binaryLength));
+    u32 binaryFormat{};
+    glGetProgramBinary(program, binaryLength, nullptr, &binaryFormat, binary.data());
+
+    // written to the side and renamed, so a crash never leaves a truncated entry behind
+    const auto path = EntryPath(key);
+    auto temporaryPath = path;
+    temporaryPath += ".tmp";
+    {
+        std::ofstream file(temporaryPath, std::ios::binary | std::ios::trunc);
+        const EntryHeader header{ kMagic, kVersion, binaryFormat, static_cast<u32>(binaryLength) };
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(binary.data(), static_cast<std::streamsize>(binary.size()));
+        if (!file)
+        {
+            std::clog << "ProgramBinaryCache: Unable to write " << temporaryPath.string() << '\n';
+            return;
+        }
+    }
+
+    std::error_code error;
+    std::filesystem::rename(temporaryPath, path, error);
+    if (error)
+    {
+        std::filesystem::remove(temporaryPath, error);
+    }
+}
+
+std::filesystem::path ProgramBinaryCache::EntryPath(const u64 key) const
+{
+    char fileName[32];
+    snprintf(fileName, sizeof(fileName), "%016llx.bin", static_cast<unsigned long long>(key));
+    return _directory / fileName;
+}
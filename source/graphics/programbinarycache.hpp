@@ -0,0 +1,30 @@
+#pragma once
+
+#include "types.hpp"
+
+#include <filesystem>
+#include <string>
+#include <string_view>
+
+// Stores linked separable shader programs on disk via glGetProgramBinary. Entries are keyed by a
+// hash of the stage, the complete source text and the driver identification, so edited shaders,
+// different defines and driver updates all miss instead of loading stale binaries.
+class ProgramBinaryCache final
+{
+public:
+    explicit ProgramBinaryCache(std::filesystem::path directory);
+
+    [[nodiscard]] bool IsEnabled() const;
+    [[nodiscard]] u64 Key(const u32 stage, const std::string_view source) const;
+
+    // returns a linked separable program, or 0 if there is no entry or the driver rejects it
+    [[nodiscard]] u32 Load(const u64 key) const;
+    void Store(const u64 key, const u32 program) const;
+
+private:
+    [[nodiscard]] std::filesystem::path EntryPath(const u64 key) const;
+
+    std::filesystem::path _directory;
+    std::string _driver;
+    bool _isEnabled{ false };
+};
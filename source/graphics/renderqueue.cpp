@@ -0,0 +1,106 @@
+#include "graphics/renderqueue.hpp"
+
+#include <algorithm>
+#include <array>
+
+u64 RenderQueue::MakeKey(
+    const RenderPass pass,
+    const u32 programId,
+    const u32 materialId,
+    const u32 geometryId,
+    const f32 depth)
+{
+    auto constexpr depthMax = (1u << DepthBits) - 1;
+    const auto depthBucket = static_cast<u32>(std::clamp(depth, 0.0f, 1.0f) * static_cast<f32>(depthMax));
+
+    return (static_cast<u64>(pass) & ((u64{ 1 } << PassBits) - 1)) << PassShift |
+        (static_cast<u64>(programId) & ((u64{ 1 } << ProgramBits) - 1)) << ProgramShift |
+        (static_cast<u64>(materialId) & ((u64{ 1 } << MaterialBits) - 1)) << MaterialShift |
+        (static_cast<u64>(geometryId) & ((u64{ 1 } << GeometryBits) - 1)) << GeometryShift |
+        static_cast<u64>(depthBucket) << DepthShift;
+}
+
+void RenderQueue::Clear()
+{
+    _items.clear();
+    _statistics = {};
+}
+
+void RenderQueue::Push(const u64 key, const u32 payload)
+{
+    _items.push_back({ key, payload });
+}
+
+void RenderQueue::Append(const RenderQueueItem* items, const u32 count)
+{
+    _items.insert(_items.end(), items, items + count);
+}
+
+void RenderQueue::Sort()
+{
+    auto constexpr radixBits = 8;
+    auto constexpr radixSize = 1u << radixBits;
+    auto constexpr passCount = 64 / radixBits;
+
+    const auto itemCount = _items.size();
+    if (itemCount < 2)
+    {
+        return;
+    }
+
+    // histograms for all digits are gathered in a single sweep
+    std::array<std::array<u32, radixSize>, passCount> histograms{};
+    for (const auto& item : _items)
+    {
+        for (auto pass = 0; pass < passCount; ++pass)
+        {
+            histograms[pass][(item.Key >> (pass * radixBits)) & (radixSize - 1)]++;
+        }
+    }
+
+    _scratch.resize(itemCount);
+    auto* source = &_items;
+    auto* destination = &_scratch;
+
+    for (auto pass = 0; pass < passCount; ++pass)
+    {
+        auto& histogram = histograms[pass];
+        const auto shift = pass * radixBits;
+
+        // every key shares this digit, the pass would only copy
+        if (histogram[((*source)[0].Key >> shift) & (radixSize - 1)] == itemCount)
+        {
+            continue;
+        }
+
+        u32 offset = 0;
+        for (auto& count : histogram)
+        {
+            const auto bucketCount = count;
+            count = offset;
+            offset += bucketCount;
+        }
+
+        for (const auto& item : *source)
+        {
+            (*destination)[histogram[(item.Key >> shift) & (radixSize - 1)]++] = item;
+        }
+
+        std::swap(source, destination);
+    }
+
+    if (source != &_items)
+    {
+        _items.swap(_scratch);
+    }
+}
+
+const std::vector<RenderQueueItem>& RenderQueue::Items() const
+{
+    return _items;
+}
+
+RenderQueueStatistics& RenderQueue::Statistics()
+{
+    return _statistics;
+}
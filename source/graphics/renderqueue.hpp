@@ -0,0 +1,82 @@
+#pragma once
+
+#include "types.hpp"
+
+#include <vector>
+
+enum class RenderPass : u32
+{
+    Opaque = 0,
+    Instanced = 1
+};
+
+struct RenderQueueItem
+{
+    u64 Key;
+    u32 Payload;
+};
+
+// how much state the submission loop actually changed versus what
+// an unsorted loop binding everything per draw would have changed
+struct RenderQueueStatistics
+{
+    u32 DrawCount;
+    u32 InstanceCount;
+    u32 ProgramChanges;
+    u32 MaterialChanges;
+    u32 GeometryChanges;
+    u32 ProgramChangesAvoided;
+    u32 MaterialChangesAvoided;
+    u32 GeometryChangesAvoided;
+};
+
+// Collects draws as 64 bit sort keys plus a payload index and sorts them so that
+// draws sharing state end up next to each other. The key layout from msb to lsb is
+// pass (4) | program (8) | material (16) | geometry (16) | depth bucket (20)
+class RenderQueue final
+{
+public:
+    static constexpr u32 PassBits = 4;
+    static constexpr u32 ProgramBits = 8;
+    static constexpr u32 MaterialBits = 16;
+    static constexpr u32 GeometryBits = 16;
+    static constexpr u32 DepthBits = 20;
+
+    static constexpr u32 DepthShift = 0;
+    static constexpr u32 GeometryShift = DepthShift + DepthBits;
+    static constexpr u32 MaterialShift = GeometryShift + GeometryBits;
+    static constexpr u32 ProgramShift = MaterialShift + MaterialBits;
+    static constexpr u32 PassShift = ProgramShift + ProgramBits;
+
+    // depth is the normalized view distance in [0, 1], smaller values sort first
+    [[nodiscard]] static u64 MakeKey(
+        const RenderPass pass,
+        const u32 programId,
+        const u32 materialId,
+        const u32 geometryId,
+        const f32 depth);
+
+    [[nodiscard]] static u32 Pass(const u64 key) { return Field(key, PassShift, PassBits); }
+    [[nodiscard]] static u32 Program(const u64 key) { return Field(key, ProgramShift, ProgramBits); }
+    [[nodiscard]] static u32 Material(const u64 key) { return Field(key, MaterialShift, MaterialBits); }
+    [[nodiscard]] static u32 Geometry(const u64 key) { return Field(key, GeometryShift, GeometryBits); }
+
+    void Clear();
+    void Push(const u64 key, const u32 payload);
+    // merges items built elsewhere, for example by worker threads, Sort orders them with the rest
+    void Append(const RenderQueueItem* items, const u32 count);
+    void Sort();
+
+    [[nodiscard]] const std::vector<RenderQueueItem>& Items() const;
+    [[nodiscard]] RenderQueueStatistics& Statistics();
+
+private:
+    [[nodiscard]] static u32 Field(const u64 key, const u32 shift, const u32 bits)
+    {
+        return static_cast<u32>((key >> shift) & ((u64{ 1 } << bits) - 1));
+    }
+
+    std::vector<RenderQueueItem> _items;
+    std::vector<RenderQueueItem> _scratch;
+    RenderQueueStatistics _statistics{};
+};
@@ -0,0 +1,184 @@
+#include "graphics/rendertargetmanager.hpp"
+#include "graphics/framebuffer.hpp"
+#include "graphics/graphicsdevice.hpp"
+#include "graphics/textures.hpp"
+
+#include <algorithm>
+#include <iostream>
+
+RenderTargetManager::RenderTargetManager(
+    GraphicsDevice& graphicsDevice,
+    const glm::ivec2& size,
+    const f64 debounceSeconds)
+    : _graphicsDevice{ graphicsDevice },
+    _size{ size },
+    _targetSize{ BucketSize(size) },
+    _debounceSeconds{ debounceSeconds }
+{
+}
+
+RenderTargetManager::~RenderTargetManager()
+{
+    for (auto& framebuffer : _framebuffers)
+    {
+        delete *framebuffer.Target;
+        *framebuffer.Target = nullptr;
+    }
+    for (auto& texture : _textures)
+    {
+        delete *texture.Target;
+        *texture.Target = nullptr;
+    }
+    for (auto& pooledTexture : _pool)
+    {
+        delete pooledTexture.Instance;
+    }
+}
+
+void RenderTargetManager::AddTexture(
+    Texture*& target,
+    const u32 internalFormat,
+    const u32 format,
+    const u32 filter,
+    const s32 divisor)
+{
+    _textures.push_back({ &target, internalFormat, format, filter, divisor });
+    target = AcquireTexture(_textures.back());
+}
+
+void RenderTargetManager::AddFramebuffer(
+    Framebuffer*& target,
+    const std::string& label,
+    const std::vector<Texture**>& colorAttachments,
+    Texture** depthAttachment)
+{
+    _framebuffers.push_back({ &target, label, colorAttachments, depthAttachment });
+    CreateFramebuffer(_framebuffers.back());
+}
+
+void RenderTargetManager::RequestResize(const glm::ivec2& size, const f64 time)
+{
+    // minimized windows report a zero size, keep everything as it is until they come back
+    if (size.x <= 0 || size.y <= 0)
+    {
+        return;
+    }
+
+    _pendingSize = size;
+    _pendingTime = time;
+    _isResizePending = true;
+}
+
+bool RenderTargetManager::Update(const f64 time)
+{
+    if (!_isResizePending || time - _pendingTime < _debounceSeconds)
+    {
+        return false;
+    }
+    _isResizePending = false;
+
+    if (_pendingSize == _size)
+    {
+        return false;
+    }
+
+    _size = _pendingSize;
+    const auto targetSize = BucketSize(_size);
+    if (targetSize == _targetSize)
+    {
+        // still fits the current allocations, only the presented size changes
+        return true;
+    }
+
+    _targetSize = targetSize;
+    _generation++;
+
+    for (auto& framebuffer : _framebuffers)
+    {
+        delete *framebuffer.Target;
+        *framebuffer.Target = nullptr;
+    }
+
+    for (auto& texture : _textures)
+    {
+        const auto* oldTexture = *texture.Target;
+        _pool.push_back({ *texture.Target, texture.InternalFormat, texture.Format, texture.Filter, glm::ivec2(oldTexture->Width(), oldTexture->Height()), _generation });
+        *texture.Target = AcquireTexture(texture);
+    }
+
+    for (auto& framebuffer : _framebuffers)
+    {
+        CreateFramebuffer(framebuffer);
+    }
+
+    // textures that were not picked up during this or the previous resize are not coming back
+    const auto isStale = [this](const PooledTexture& pooledTexture)
+    {
+        return pooledTexture.ReleasedAtGeneration + 1 < _generation;
+    };
+    for (auto& pooledTexture : _pool)
+    {
+        if (isStale(pooledTexture))
+        {
+            delete pooledTexture.Instance;
+        }
+    }
+    _pool.erase(std::remove_if(_pool.begin(), _pool.end(), isStale), _pool.end());
+
+    std::clog << "RenderTargetManager: Resized to " << _size.x << "x" << _size.y << ", targets are " << _targetSize.x << "x" << _targetSize.y << "\n";
+    return true;
+}
+
+glm::ivec2 RenderTargetManager::Size() const
+{
+    return _size;
+}
+
+glm::ivec2 RenderTargetManager::TargetSize() const
+{
+    return _targetSize;
+}
+
+glm::ivec2 RenderTargetManager::BucketSize(const glm::ivec2& size)
+{
+    auto constexpr bucketGranularity = 128;
+    return glm::ivec2(
+        (size.x + bucketGranularity - 1) / bucketGranularity * bucketGranularity,
+        (size.y + bucketGranularity - 1) / bucketGranularity * bucketGranularity);
+}
+
+Texture* RenderTargetManager::AcquireTexture(const TextureSlot& slot)
+{
+    const auto size = (_targetSize + slot.Divisor - 1) / slot.Divisor;
+    const auto pooledTexture = std::find_if(_pool.begin(), _pool.end(), [&](const PooledTexture& candidate)
+    {
+        return candidate.InternalFormat == slot.InternalFormat &&
+            candidate.Format == slot.Format &&
+            candidate.Filter == slot.Filter &&
+            candidate.Size == size;
+    });
+
+    if (pooledTexture != _pool.end())
+    {
+        const auto texture = pooledTexture->Instance;
+        _pool.erase(pooledTexture);
+        return texture;
+    }
+
+    return _graphicsDevice.CreateTexture(slot.InternalFormat, slot.Format, size.x, size.y, nullptr, slot.Filter);
+}
+
+void RenderTargetManager::CreateFramebuffer(const FramebufferSlot& slot)
+{
+    std::vector<Texture*> colorAttachments;
+    colorAttachments.reserve(slot.ColorAttachments.size());
+    for (const auto colorAttachment : slot.ColorAttachments)
+    {
+        colorAttachments.push_back(*colorAttachment);
+    }
+
+    *slot.Target = _graphicsDevice.CreateFramebuffer(
+        slot.Label,
+        colorAttachments,
+        slot.DepthAttachment != nullptr ? *slot.DepthAttachment : nullptr);
+}
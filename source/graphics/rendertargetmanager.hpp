@@ -0,0 +1,96 @@
+#pragma once
+
+#include "types.hpp"
+
+#include <glm/glm.hpp>
+
+#include <string>
+#include <vector>
+
+class Framebuffer;
+class GraphicsDevice;
+class Texture;
+
+// Owns the textures and framebuffers whose size follows the window. Resizes are debounced and
+// applied at the start of a frame. Textures are allocated at a size rounded up to a bucket, so
+// small resizes reuse the current allocations, and released textures are pooled for one more
+// resize in case the window is dragged back before they are freed.
+class RenderTargetManager final
+{
+public:
+    RenderTargetManager(
+        GraphicsDevice& graphicsDevice,
+        const glm::ivec2& size,
+        const f64 debounceSeconds = 0.2);
+    ~RenderTargetManager();
+
+    RenderTargetManager(const RenderTargetManager&) = delete;
+    RenderTargetManager& operator=(const RenderTargetManager&) = delete;
+
+    // target is updated whenever the texture behind it is replaced, divisor 2 gives a half resolution target
+    void AddTexture(
+        Texture*& target,
+        const u32 internalFormat,
+        const u32 format,
+        const u32 filter,
+        const s32 divisor = 1);
+    void AddFramebuffer(
+        Framebuffer*& target,
+        const std::string& label,
+        const std::vector<Texture**>& colorAttachments,
+        Texture** depthAttachment = nullptr);
+
+    void RequestResize(const glm::ivec2& size, const f64 time);
+    // applies a pending resize once it has been stable for the debounce time, returns true if the size changed
+    bool Update(const f64 time);
+
+    // size the frame is presented at
+    [[nodiscard]] glm::ivec2 Size() const;
+    // size the textures are allocated at, at least Size
+    [[nodiscard]] glm::ivec2 TargetSize() const;
+
+private:
+    struct TextureSlot
+    {
+        Texture** Target;
+        u32 InternalFormat;
+        u32 Format;
+        u32 Filter;
+        s32 Divisor;
+    };
+
+    struct FramebufferSlot
+    {
+        Framebuffer** Target;
+        std::string Label;
+        std::vector<Texture**> ColorAttachments;
+        Texture** DepthAttachment;
+    };
+
+    struct PooledTexture
+    {
+        Texture* Instance;
+        u32 InternalFormat;
+        u32 Format;
+        u32 Filter;
+        glm::ivec2 Size;
+        u32 ReleasedAtGeneration;
+    };
+
+    [[nodiscard]] static glm::ivec2 BucketSize(const glm::ivec2& size);
+    [[nodiscard]] Texture* AcquireTexture(const TextureSlot& slot);
+    void CreateFramebuffer(const FramebufferSlot& slot);
+
+    GraphicsDevice& _graphicsDevice;
+    std::vector<TextureSlot> _textures;
+    std::vector<FramebufferSlot> _framebuffers;
+    std::vector<PooledTexture> _pool;
+
+    glm::ivec2 _size{};
+    glm::ivec2 _targetSize{};
+    glm::ivec2 _pendingSize{};
+    f64 _pendingTime{};
+    f64 _debounceSeconds{};
+    bool _isResizePending{};
+    u32 _generation{};
+};
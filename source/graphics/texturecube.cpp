@@ -1,10 +1,13 @@
 #include "graphics/texturecube.hpp"
+#include "profiling/cpuprofiler.hpp"
 
 #include <stdexcept>
 #include <cstring>
+#include <string>
 
 TextureCube* TextureCube::FromFiles(const std::array<std::string_view, 6>& filePaths, u32 comp)
 {
+    PROFILE_SCOPE("TextureCube::FromFiles");
     s32 width{};
     s32 height{};
     s32 components{};
@@ -26,6 +29,14 @@ TextureCube* TextureCube::FromFiles(const std::array<std::string_view, 6>& fileP
     for (size_t i = 0; i < 6; i++)
     {
         faces[i] = stbi_load(filePaths[i].data(), &width, &height, &components, comp);
+        if (faces[i] == nullptr)
+        {
+            for (auto face : faces)
+            {
+                stbi_image_free(face);
+            }
+            throw std::runtime_error(std::string("TextureCube: Unable to load ") + std::string(filePaths[i]) + ", " + stbi_failure_reason() + '.');
+        }
     }
 
     const auto textureCube = new TextureCube(internalFormat, format, width, height, faces);
@@ -1,4 +1,5 @@
 #include "graphics/textures.hpp"
+#include "profiling/cpuprofiler.hpp"
 
 #define STB_IMAGE_IMPLEMENTATION
 #include <stb_image.h>
@@ -8,6 +9,7 @@
 
 Texture* Texture::FromFile(const std::string_view filepath, const u32 component)
 {
+    PROFILE_SCOPE("Texture::FromFile");
     s32 width{};
     s32 height{};
     s32 components{};
@@ -18,7 +20,14 @@ Texture* Texture::FromFile(const std::string_view filepath, const u32 component)
         message << "Texture: File " << filepath.data() << " does not exist.";
         throw std::runtime_error(message.str());
     }
+    // a file still being written by an editor exists but does not decode yet
     const auto data = stbi_load(filepath.data(), &width, &height, &components, component);
+    if (data == nullptr)
+    {
+        std::ostringstream message;
+        message << "Texture: Unable to load " << filepath.data() << ", " << stbi_failure_reason() << '.';
+        throw std::runtime_error(message.str());
+    }
 
     auto const [internalFormat, format] = [component]()
     {
@@ -38,6 +47,8 @@ Texture* Texture::FromFile(const std::string_view filepath, const u32 component)
 }
 
 Texture::Texture(const u32 internalFormat, const u32 format, const s32 width, const s32 height, void* data, const u32 filter, const u32 wrap)
+    : _width{ width },
+    _height{ height }
 {
     glCreateTextures(GL_TEXTURE_2D, 1, &_id);
     glTextureStorage2D(_id, 1, internalFormat, width, height);
@@ -67,6 +78,16 @@ u32 Texture::Id() const
     return _id;
 }
 
+s32 Texture::Width() const
+{
+    return _width;
+}
+
+s32 Texture::Height() const
+{
+    return _height;
+}
+
 void Texture::Bind(const u32 textureUnit) const
 {
     glBindTextureUnit(textureUnit, _id);
@@ -16,9 +16,13 @@ public:
     ~Texture();
 
     [[nodiscard]] u32 Id() const;
+    [[nodiscard]] s32 Width() const;
+    [[nodiscard]] s32 Height() const;
     void Bind(const u32 textureUnit) const;
 private:
     u32 _id{};
+    s32 _width{};
+    s32 _height{};
 
     static const char* FilterToString(const GLuint filter);
     static const char* WrapToString(const GLuint wrap);
@@ -0,0 +1,391 @@
+#include "io/filewatcher.hpp"
+
+#include <array>
+#include <cstring>
+#include <iostream>
+
+#if defined(__linux__)
+#include <cerrno>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+FileWatcher::FileWatcher(
+    std::filesystem::path pathToWatch,
+    const std::chrono::milliseconds pollInterval,
+    const std::chrono::milliseconds coalesceWindow)
+    : _pathToWatch{ std::move(pathToWatch) },
+    _pollInterval{ pollInterval },
+    _coalesceWindow{ coalesceWindow }
+{
+}
+
+FileWatcher::~FileWatcher()
+{
+    Stop();
+}
+
+void FileWatcher::Start()
+{
+    if (_thread.joinable())
+    {
+        return;
+    }
+
+    _isRunning = true;
+    _isEventDriven = false;
+#if defined(__linux__)
+    _isEventDriven = OpenInotify();
+#endif
+    if (!_isEventDriven)
+    {
+        std::clog << "FileWatcher: polling " << _pathToWatch.string() << " every " << _pollInterval.count() << "ms\n";
+    }
+
+    _thread = std::thread(&FileWatcher::Run, this);
+}
+
+void FileWatcher::Stop()
+{
+    if (!_thread.joinable())
+    {
+        return;
+    }
+
+    {
+        std::lock_guard lock(_mutex);
+        _isRunning = false;
+    }
+    _stopCondition.notify_all();
+#if defined(__linux__)
+    if (_wakeEvent >= 0)
+    {
+        const u64 wake = 1;
+        [[maybe_unused]] const auto written = write(_wakeEvent, &wake, sizeof(wake));
+    }
+#endif
+
+    _thread.join();
+#if defined(__linux__)
+    CloseInotify();
+#endif
+}
+
+bool FileWatcher::IsEventDriven() const
+{
+    return _isEventDriven;
+}
+
+std::vector<FileChange> FileWatcher::PollChanges()
+{
+    std::vector<FileChange> changes;
+
+    std::lock_guard lock(_mutex);
+    changes.reserve(_changes.size());
+    for (const auto& [path, status] : _changes)
+    {
+        changes.push_back({ path, status });
+    }
+    _changes.clear();
+
+    return changes;
+}
+
+void FileWatcher::Run()
+{
+#if defined(__linux__)
+    if (_isEventDriven)
+    {
+        RunInotify();
+        return;
+    }
+#endif
+    RunPolling();
+}
+
+void FileWatcher::RunPolling()
+{
+    std::unordered_map<std::string, std::filesystem::file_time_type> lastWriteTimes;
+    std::unordered_map<std::string, FileStatus> changes;
+    auto isFirstScan = true;
+
+    std::unique_lock lock(_mutex);
+    while (_isRunning)
+    {
+        lock.unlock();
+
+        // files can disappear between listing and querying them, such a scan is simply repeated next time
+        std::error_code error;
+        std::unordered_map<std::string, std::filesystem::file_time_type> currentWriteTimes;
+        for (auto file = std::filesystem::recursive_directory_iterator(_pathToWatch, error);
+            !error && file != std::filesystem::recursive_directory_iterator();
+            file.increment(error))
+        {
+            if (!file->is_regular_file(error))
+            {
+                continue;
+            }
+
+            const auto lastWriteTime = file->last_write_time(error);
+            if (!error)
+            {
+                currentWriteTimes[file->path().string()] = lastWriteTime;
+            }
+        }
+
+        if (!error)
+        {
+            if (!isFirstScan)
+            {
+                for (const auto& [path, lastWriteTime] : currentWriteTimes)
+                {
+                    const auto previous = lastWriteTimes.find(path);
+                    if (previous == lastWriteTimes.end())
+                    {
+                        Merge(changes, path, FileStatus::Created);
+                    }
+                    else if (previous->second != lastWriteTime)
+                    {
+                        Merge(changes, path, FileStatus::Modified);
+                    }
+                }
+
+                for (const auto& [path, lastWriteTime] : lastWriteTimes)
+                {
+                    if (currentWriteTimes.find(path) == currentWriteTimes.end())
+                    {
+                        Merge(changes, path, FileStatus::Erased);
+                    }
+                }
+            }
+
+            lastWriteTimes = std::move(currentWriteTimes);
+            isFirstScan = false;
+        }
+
+        // a scan sees a whole burst at once, there is nothing left to coalesce
+        Publish(changes);
+
+        lock.lock();
+        _stopCondition.wait_for(lock, _pollInterval, [this] { return !_isRunning; });
+    }
+}
+
+void FileWatcher::Publish(std::unordered_map<std::string, FileStatus>& changes)
+{
+    if (changes.empty())
+    {
+        return;
+    }
+
+    std::lock_guard lock(_mutex);
+    for (const auto& [path, status] : changes)
+    {
+        Merge(_changes, path, status);
+    }
+    changes.clear();
+}
+
+void FileWatcher::Merge(std::unordered_map<std::string, FileStatus>& changes, const std::string& path, const FileStatus status)
+{
+    const auto [change, isInserted] = changes.try_emplace(path, status);
+    if (isInserted)
+    {
+        return;
+    }
+
+    if (change->second == FileStatus::Created)
+    {
+        // a file that came and went in one burst was a temporary, writes to a new file keep it new
+        if (status == FileStatus::Erased)
+        {
+            changes.erase(change);
+        }
+        return;
+    }
+
+    // replaced by delete and create, which is how some editors save
+    change->second = change->second == FileStatus::Erased && status == FileStatus::Created
+        ? FileStatus::Modified
+        : status;
+}
+
+#if defined(__linux__)
+bool FileWatcher::OpenInotify()
+{
+    _inotify = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    _wakeEvent = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (_inotify < 0 || _wakeEvent < 0)
+    {
+        std::cerr << "FileWatcher: inotify not available, " << std::strerror(errno) << '\n';
+        CloseInotify();
+        return false;
+    }
+
+    AddWatches(_pathToWatch);
+    if (_watchedDirectories.empty())
+    {
+        CloseInotify();
+        return false;
+    }
+
+    return true;
+}
+
+void FileWatcher::CloseInotify()
+{
+    // closing the descriptor removes all of its watches
+    if (_inotify >= 0)
+    {
+        close(_inotify);
+        _inotify = -1;
+    }
+    if (_wakeEvent >= 0)
+    {
+        close(_wakeEvent);
+        _wakeEvent = -1;
+    }
+    _watchedDirectories.clear();
+}
+
+void FileWatcher::RunInotify()
+{
+    std::unordered_map<std::string, FileStatus> changes;
+    auto lastEventTime = std::chrono::steady_clock::now();
+    alignas(inotify_event) char buffer[4096];
+
+    for (;;)
+    {
+        // sleep until something happens, or until the pending burst has been quiet for the coalesce window
+        auto timeout = -1;
+        if (!changes.empty())
+        {
+            const auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - lastEventTime);
+            if (elapsed >= _coalesceWindow)
+            {
+                Publish(changes);
+            }
+            else
+            {
+                timeout = static_cast<s32>((_coalesceWindow - elapsed).count());
+            }
+        }
+
+        std::array<pollfd, 2> descriptors
+        {
+            pollfd{ _inotify, POLLIN, 0 },
+            pollfd{ _wakeEvent, POLLIN, 0 }
+        };
+        if (poll(descriptors.data(), descriptors.size(), timeout) < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+
+            std::cerr << "FileWatcher: poll failed, " << std::strerror(errno) << '\n';
+            return;
+        }
+
+        if ((descriptors[1].revents & POLLIN) != 0)
+        {
+            return;
+        }
+
+        if ((descriptors[0].revents & POLLIN) == 0)
+        {
+            continue;
+        }
+
+        for (;;)
+        {
+            const auto length = read(_inotify, buffer, sizeof(buffer));
+            if (length <= 0)
+            {
+                break;
+            }
+
+            for (auto offset = 0; offset < length;)
+            {
+                const auto event = reinterpret_cast<const inotify_event*>(buffer + offset);
+                offset += static_cast<s32>(sizeof(inotify_event) + event->len);
+
+                if ((event->mask & IN_Q_OVERFLOW) != 0)
+                {
+                    std::cerr << "FileWatcher: event queue overflowed, some changes were missed\n";
+                    continue;
+                }
+
+                if ((event->mask & IN_IGNORED) != 0)
+                {
+                    _watchedDirectories.erase(event->wd);
+                    continue;
+                }
+
+                const auto directory = _watchedDirectories.find(event->wd);
+                if (directory == _watchedDirectories.end() || event->len == 0)
+                {
+                    continue;
+                }
+
+                // watches are not recursive, directories created later need their own
+                const auto path = directory->second / event->name;
+                if ((event->mask & IN_ISDIR) != 0)
+                {
+                    if ((event->mask & (IN_CREATE | IN_MOVED_TO)) != 0)
+                    {
+                        AddWatches(path);
+                    }
+                    continue;
+                }
+
+                if ((event->mask & IN_CREATE) != 0)
+                {
+                    Merge(changes, path.string(), FileStatus::Created);
+                }
+                else if ((event->mask & (IN_CLOSE_WRITE | IN_MOVED_TO)) != 0)
+                {
+                    Merge(changes, path.string(), FileStatus::Modified);
+                }
+                else if ((event->mask & (IN_DELETE | IN_MOVED_FROM)) != 0)
+                {
+                    Merge(changes, path.string(), FileStatus::Erased);
+                }
+            }
+        }
+
+        lastEventTime = std::chrono::steady_clock::now();
+    }
+}
+
+void FileWatcher::AddWatches(const std::filesystem::path& directory)
+{
+    auto constexpr watchMask = IN_CREATE | IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM | IN_DELETE;
+
+    std::vector<std::filesystem::path> directories{ directory };
+    std::error_code error;
+    for (auto entry = std::filesystem::recursive_directory_iterator(directory, error);
+        !error && entry != std::filesystem::recursive_directory_iterator();
+        entry.increment(error))
+    {
+        if (entry->is_directory(error))
+        {
+            directories.push_back(entry->path());
+        }
+    }
+
+    for (const auto& path : directories)
+    {
+        const auto watch = inotify_add_watch(_inotify, path.c_str(), watchMask);
+        if (watch < 0)
+        {
+            std::cerr << "FileWatcher: cannot watch " << path.string() << ", " << std::strerror(errno) << '\n';
+            continue;
+        }
+
+        _watchedDirectories[watch] = path;
+    }
+}
+#endif
@@ -1,76 +1,72 @@
 #pragma once
 
-#include <filesystem>
+#include "types.hpp"
+
 #include <chrono>
+#include <condition_variable>
+#include <filesystem>
+#include <mutex>
+#include <string>
 #include <thread>
 #include <unordered_map>
-#include <string>
-#include <functional>
+#include <vector>
 
 enum class FileStatus { Created, Modified, Erased };
 
-class FileWatcher
+struct FileChange
 {
-public:
-    std::string PathToWatch;
-    std::chrono::duration<int, std::milli> Delay;
+    std::string Path;
+    FileStatus Status;
+};
 
-    FileWatcher(std::string pathToWatch, std::chrono::duration<int, std::milli> delay)
-    : PathToWatch{pathToWatch}, Delay{delay}
+// Watches a directory tree on a background thread. On Linux inotify reports changes as they happen,
+// elsewhere, or when inotify is unavailable, the tree is re-scanned every pollInterval.
+// Bursts of events for one file (an editor truncating, writing and renaming on save) are coalesced
+// into one change, which the render thread picks up with PollChanges
+class FileWatcher final
 {
-        for (auto& file : std::filesystem::recursive_directory_iterator(PathToWatch))
-        {
-            _paths[file.path().string()] = std::filesystem::last_write_time(file);
-        }
-    }
+public:
+    FileWatcher(
+        std::filesystem::path pathToWatch,
+        std::chrono::milliseconds pollInterval,
+        std::chrono::milliseconds coalesceWindow = std::chrono::milliseconds(25));
+    ~FileWatcher();
 
-    void Start(const std::function<void(std::string, FileStatus)>& action)
-    {
-        while (_running)
-        {
-            std::this_thread::sleep_for(Delay);
+    void Start();
+    void Stop();
 
-            auto it = _paths.begin();
-            while (it != _paths.end()) 
-            {
-                if (!std::filesystem::exists(it->first)) 
-                {
-                    action(it->first, FileStatus::Erased);
-                    it = _paths.erase(it);
-                }
-                else 
-                {
-                    ++it;
-                }
-            }
+    [[nodiscard]] bool IsEventDriven() const;
 
-            for (auto& file : std::filesystem::recursive_directory_iterator(PathToWatch))
-            {
-                auto currentFileLastWriteTime = std::filesystem::last_write_time(file);
+    // changes published since the last call, paths are relative to the working directory like the watched path
+    [[nodiscard]] std::vector<FileChange> PollChanges();
 
-                if (!Contains(file.path().string())) 
-                {
-                    _paths[file.path().string()] = currentFileLastWriteTime;
-                    action(file.path().string(), FileStatus::Created);
-                }
-                else
-                {
-                    if (_paths[file.path().string()] != currentFileLastWriteTime) 
-                    {
-                        _paths[file.path().string()] = currentFileLastWriteTime;
-                        action(file.path().string(), FileStatus::Modified);
-                    }
-                }
-            }
-        }
-    }
 private:
-    std::unordered_map<std::string, std::filesystem::file_time_type> _paths;
-    bool _running = true;
+    void Run();
+    void RunPolling();
+    void Publish(std::unordered_map<std::string, FileStatus>& changes);
+
+    static void Merge(std::unordered_map<std::string, FileStatus>& changes, const std::string& path, const FileStatus status);
+
+#if defined(__linux__)
+    bool OpenInotify();
+    void CloseInotify();
+    void RunInotify();
+    void AddWatches(const std::filesystem::path& directory);
+
+    s32 _inotify{ -1 };
+    s32 _wakeEvent{ -1 };
+    std::unordered_map<s32, std::filesystem::path> _watchedDirectories;
+#endif
+
+    std::filesystem::path _pathToWatch;
+    std::chrono::milliseconds _pollInterval;
+    std::chrono::milliseconds _coalesceWindow;
+
+    std::thread _thread;
+    std::mutex _mutex;
+    std::condition_variable _stopCondition;
+    bool _isRunning{ false };
+    bool _isEventDriven{ false };
 
-    bool Contains(const std::string& key)
-    {
-        const auto iterator = _paths.find(key);
-        return iterator != _paths.end();
-    }
-};
\ No newline at end of file
+    std::unordered_map<std::string, FileStatus> _changes;
+};
@@ -9,11 +9,27 @@
 #include "graphics/light.hpp"
 #include "graphics/framebuffer.hpp"
 #include "graphics/meshdata.hpp"
+#include "graphics/instanceculler.hpp"
+#include "graphics/dynamicresolution.hpp"
+#include "graphics/framedataring.hpp"
+#include "graphics/framesinflight.hpp"
+#include "graphics/gpuprofiler.hpp"
+#include "graphics/hierarchicalzbuffer.hpp"
+#include "graphics/instancebatcher.hpp"
+#include "graphics/motionblurtiles.hpp"
+#include "graphics/renderqueue.hpp"
+#include "graphics/rendertargetmanager.hpp"
 #include "io/filewatcher.hpp"
+#include "math/bounds.hpp"
 #include "math/frustum.hpp"
 #include "physics.hpp"
+#include "profiling/benchmark.hpp"
+#include "profiling/cpuprofiler.hpp"
 #include "scenes/scenenode.hpp"
 #include "scenes/spacescene.hpp"
+#include "threading/jobgraph.hpp"
+#include "threading/spscqueue.hpp"
+#include "threading/threadpool.hpp"
 #include "types.hpp"
 #include "camera.hpp"
 
@@ -27,7 +43,15 @@
 #include <glm/gtx/quaternion.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cstdlib>
+#include <filesystem>
 #include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
 #include <vector>
 
 
@@ -42,10 +66,21 @@ Light* g_Camera_Light{ nullptr };
 
 Program* g_FinalProgram{ nullptr };
 Program* g_GeometryProgram{ nullptr };
+// permutation bits of g_GeometryProgram and g_LightProgram, in the order of their feature lists
+constexpr u32 kGeometryPermutationInstanced = 1u << 0;
+constexpr u32 kGeometryPermutationExcludeFromMotionBlur = 1u << 1;
+constexpr u32 kLightPermutationSpotLight = 1u << 0;
 Program* g_MotionBlurProgram{ nullptr };
 Program* g_LightProgram{ nullptr };
 Program* g_QuadProgram{ nullptr };
 Program* g_EmissionProgram{ nullptr };
+Program* g_InstanceCullProgram{ nullptr };
+Program* g_HierarchicalZBufferProgram{ nullptr };
+Program* g_UpscaleProgram{ nullptr };
+Program* g_PostProgram{ nullptr };
+Program* g_MotionBlurTileMaxProgram{ nullptr };
+Program* g_MotionBlurNeighborMaxProgram{ nullptr };
+Program* g_MotionBlurUpsampleProgram{ nullptr };
 
 Geometry* g_EmptyGeometry{ nullptr };
 Geometry* g_CubeGeometry{ nullptr };
@@ -61,6 +96,7 @@ Texture* g_gBufferDepthTexture{ nullptr };
 Texture* g_gBufferVelocityTexture{ nullptr };
 Texture* g_LightBufferTexture{ nullptr };
 Texture* g_MotionBlurTexture{ nullptr };
+Texture* g_MotionBlurHalfTexture{ nullptr };
 Texture* g_TransitionTexture{ nullptr };
 Texture* g_EmissionTexture{ nullptr };
 
@@ -68,21 +104,109 @@ Framebuffer* g_GeometryFramebuffer{ };
 Framebuffer* g_EmissionFramebuffer{ };
 Framebuffer* g_FinalFramebuffer{ };
 Framebuffer* g_MotionBlurFramebuffer{ };
+Framebuffer* g_MotionBlurHalfFramebuffer{ };
 Framebuffer* g_LightsFramebuffer{ };
 Framebuffer* g_TransitionFramebuffer{ };
 
 TextureCube* g_SkyboxTextureCube{ };
 
+constexpr std::array<std::string_view, 6> kSkyboxFilePaths
+{
+    "data/textures/TC_SkySpace_Xn.png",
+    "data/textures/TC_SkySpace_Xp.png",
+    "data/textures/TC_SkySpace_Yn.png",
+    "data/textures/TC_SkySpace_Yp.png",
+    "data/textures/TC_SkySpace_Zn.png",
+    "data/textures/TC_SkySpace_Zp.png"
+};
+constexpr std::string_view kShipModelFilePath = "data/models/SM_ShipA_noWindshield.obj";
+constexpr std::string_view kPointLightModelFilePath = "data/models/SM_PointLight.obj";
+
+// the simulation of the next frame runs while the current one renders, --no-pipelined-physics
+bool g_IsPhysicsPipelined{ true };
+physx::PxBroadPhaseType::Enum g_PhysicsBroadPhase{ physx::PxBroadPhaseType::eABP };
+// fixed simulation rate whatever the refresh rate, --physics-rate=hz and --physics-max-substeps=n
+f32 g_PhysicsStepsPerSecond{ 60.0f };
+u32 g_PhysicsMaxSubsteps{ 4 };
+
+// reloads shaders, the skybox and meshes when they change under data/, --no-hot-reload
+FileWatcher* g_FileWatcher{ nullptr };
+bool g_IsHotReloadEnabled{ true };
+
+InstanceCuller* g_AsteroidCuller{ nullptr };
+HierarchicalZBuffer* g_HierarchicalZBuffer{ nullptr };
+RenderTargetManager* g_RenderTargetManager{ nullptr };
+MotionBlurTiles* g_MotionBlurTiles{ nullptr };
+RenderQueue g_GeometryRenderQueue;
+InstanceBatcher g_GeometryInstanceBatcher;
+FrameDataRing* g_FrameDataRing{ nullptr };
+FramesInFlight* g_FramesInFlight{ nullptr };
+GpuProfiler* g_GpuProfiler{ nullptr };
+DynamicResolution* g_DynamicResolution{ nullptr };
+u32 g_LinearSampler{};
+// gpu time per frame the dynamic resolution aims for, --target-frame-time=ms
+f32 g_TargetFrameMilliseconds{ 1000.0f / 60.0f };
+bool g_IsDynamicResolutionEnabled{ true };
+// how many frames the cpu may record ahead of the gpu, --frames-in-flight=n
+u32 g_FramesInFlightDepth{ 2 };
+std::vector<LightData> g_VisibleLightData;
+
+// std140 layout of the FrameData uniform block shared by the gbuffer and light shaders
+struct FrameUniforms
+{
+    glm::mat4 Projection;
+    glm::mat4 View;
+    glm::mat4 ViewProjection;
+    glm::mat4 ViewProjectionPrevious;
+    glm::vec4 CameraPosition;
+};
+
 std::vector<Material*> g_Materials;
 std::vector<Scene*> g_Scenes;
 Scene* g_Scene_Current{ nullptr };
 
 Frustum g_Frustum;
 
+ThreadPool* g_ThreadPool{ nullptr };
+// shared by scene jobs and PhysX, 0 picks one worker per hardware thread besides the main thread
+u32 g_WorkerThreadCount{ 0 };
+bool g_IsWorkerPinningEnabled{ false };
+
+// scene update, culling and draw packet building for a frame, see StartSceneJobs
+JobGraph g_SceneJobs;
+constexpr u32 kSceneJobChunkSize = 256;
+// a run of draw packets one job appended to its worker's arena
+struct DrawPacketSpan
+{
+    const RenderQueueItem* Items;
+    u32 Count;
+};
+// one arena and queue per worker, each has a single producer and only the render thread consumes.
+// The render thread runs scene jobs too while it waits on the pool, it has the last arena and
+// appends its packets to the render queue directly
+std::vector<std::vector<RenderQueueItem>> g_DrawPacketArenas;
+std::vector<std::unique_ptr<SpscQueue<DrawPacketSpan, 64>>> g_DrawPacketQueues;
+std::thread::id g_RenderThreadId;
+
 bool g_IsMotionBlurEnabled{ true };
+// blur moving neighborhoods at half resolution and upsample, --motion-blur-half-resolution
+bool g_IsMotionBlurHalfResolution{ false };
 bool g_IsVsyncEnabled{ true };
 
+// distance beyond which asteroids are culled, 0 disables distance culling
+f32 g_AsteroidCullDistance{ 0.0f };
+bool g_IsOcclusionCullingEnabled{ true };
+
 bool g_IsTransitionEffectEnabled{ false };
+// resolve and transition in one compute dispatch instead of separate fullscreen passes, --fused-post
+bool g_IsFusedPostEnabled{ false };
+bool g_WasProfileExportKeyDown{ false };
+bool g_WasCpuTraceKeyDown{ false };
+// written on exit when set, --cpu-trace=file.json
+std::string g_CpuTraceFilePath;
+// --benchmark renders a fixed camera flight in an invisible window and writes a report
+bool g_IsBenchmarkEnabled{ false };
+BenchmarkSettings g_BenchmarkSettings;
 glm::vec4 g_Transition_Factor{ 0.0f, 0.0f, 0.0f, 0.0f };
 
 inline float Lerp(const f32 a, const f32 b, const f32 f)
@@ -92,12 +216,32 @@ inline float Lerp(const f32 a, const f32 b, const f32 f)
 
 void Cleanup()
 {
+    delete g_FileWatcher;
+
     delete g_GeometryProgram;
     delete g_FinalProgram;
     delete g_MotionBlurProgram;
     delete g_LightProgram;
     delete g_QuadProgram;
     delete g_EmissionProgram;
+    delete g_InstanceCullProgram;
+    delete g_HierarchicalZBufferProgram;
+    delete g_UpscaleProgram;
+    delete g_PostProgram;
+    delete g_MotionBlurTileMaxProgram;
+    delete g_MotionBlurNeighborMaxProgram;
+    delete g_MotionBlurUpsampleProgram;
+
+    delete g_AsteroidCuller;
+    delete g_HierarchicalZBuffer;
+    delete g_MotionBlurTiles;
+    // owns the size dependent textures and framebuffers
+    delete g_RenderTargetManager;
+    delete g_FrameDataRing;
+    delete g_FramesInFlight;
+    delete g_GpuProfiler;
+    delete g_DynamicResolution;
+    glDeleteSamplers(1, &g_LinearSampler);
 
     delete g_CubeGeometry;
     delete g_PlaneGeometry;
@@ -105,24 +249,6 @@ void Cleanup()
     delete g_ShipGeometry;
     delete g_PointLightGeometry;
 
-    delete g_GeometryFramebuffer;
-    delete g_FinalFramebuffer;
-    delete g_MotionBlurFramebuffer;
-    delete g_LightsFramebuffer;
-    delete g_TransitionFramebuffer;
-    delete g_EmissionFramebuffer;
-
-    delete g_gBufferFinalTexture;
-    delete g_gBufferPositionTexture;
-    delete g_gBufferNormalTexture;
-    delete g_gBufferAlbedoTexture;
-    delete g_gBufferDepthTexture;
-    delete g_gBufferVelocityTexture;
-    delete g_LightBufferTexture;
-    delete g_MotionBlurTexture;
-    delete g_TransitionTexture;
-    delete g_EmissionTexture;
-
     delete g_SkyboxTextureCube;
 
     for (auto material : g_Materials)
@@ -135,6 +261,8 @@ void Cleanup()
     }
 
     delete g_PhysicsScene;
+
+    delete g_ThreadPool;
 }
 
 void HandleInput(const f32 /*deltaTime*/)
@@ -199,17 +327,36 @@ void HandleInput(const f32 /*deltaTime*/)
     {
         g_IsTransitionEffectEnabled = true;
     }
+
+    const auto isProfileExportKeyDown = glfwGetKey(g_Window, GLFW_KEY_F2) == GLFW_PRESS;
+    if (isProfileExportKeyDown && !g_WasProfileExportKeyDown)
+    {
+        g_GpuProfiler->ExportCsv("gpu_profile.csv");
+        g_GpuProfiler->ExportJson("gpu_profile.json");
+        std::clog << "GpuProfiler: Exported gpu_profile.csv and gpu_profile.json\n";
+    }
+    g_WasProfileExportKeyDown = isProfileExportKeyDown;
+
+    const auto isCpuTraceKeyDown = glfwGetKey(g_Window, GLFW_KEY_F3) == GLFW_PRESS;
+    if (isCpuTraceKeyDown && !g_WasCpuTraceKeyDown && CpuProfiler::WriteChromeTrace("cpu_trace.json"))
+    {
+        std::clog << "CpuProfiler: Exported cpu_trace.json\n";
+    }
+    g_WasCpuTraceKeyDown = isCpuTraceKeyDown;
 }
 
 void Update(const float deltaTime)
 {
+    PROFILE_FUNCTION();
     glfwPollEvents();
-    HandleInput(deltaTime);
+    if (!g_IsBenchmarkEnabled)
+    {
+        HandleInput(deltaTime);
+    }
 
-    g_PhysicsScene->Step(deltaTime);
+    g_PhysicsScene->Advance(deltaTime);
     
-    const auto physicsCamera = g_PhysicsScene->Camera;
-    const auto transform = physicsCamera->getGlobalPose();
+    const auto& transform = g_PhysicsScene->Snapshot().Camera;
 
     const auto pos = glm::vec3(transform.p.x, transform.p.y, transform.p.z);
     const auto quat = glm::quat(transform.q.w, transform.q.x, transform.q.y, transform.q.z);
@@ -233,9 +380,11 @@ void Update(const float deltaTime)
 
 void WindowOnFramebufferResized(GLFWwindow* /*window*/, const int width, const int height)
 {
-    //g_Window_Width = width;
-    //g_Window_Height = height;
-    glViewport(0, 0, width, height);
+    // dragging a window edge reports every intermediate size, the targets follow once it settles
+    if (g_RenderTargetManager != nullptr)
+    {
+        g_RenderTargetManager->RequestResize(glm::ivec2(width, height), glfwGetTime());
+    }
 }
 
 void WindowOnMouseMove(GLFWwindow* /*window*/, const double xPos, const double yPos)
@@ -261,7 +410,8 @@ GLFWwindow* CreateMainWindow(
     const s32 screenHeight,
     const s32 windowWidth,
     const s32 windowHeight,
-    const std::string_view title)
+    const std::string_view title,
+    const bool isVisible)
 {
     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
     glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 6);
@@ -270,6 +420,7 @@ GLFWwindow* CreateMainWindow(
 #if _DEBUG
     glfwWindowHint(GLFW_OPENGL_DEBUG_CONTEXT, GL_TRUE);
 #endif
+    glfwWindowHint(GLFW_VISIBLE, isVisible ? GLFW_TRUE : GLFW_FALSE);
 
     const auto window = glfwCreateWindow(windowWidth, windowHeight, title.data(), nullptr, nullptr);
     if (window == nullptr)
@@ -281,7 +432,10 @@ GLFWwindow* CreateMainWindow(
     glfwSetFramebufferSizeCallback(window, WindowOnFramebufferResized);
     glfwSetCursorPosCallback(window, WindowOnMouseMove);
 
-    glfwSetWindowPos(window, screenWidth / 2 - windowWidth / 2, screenHeight / 2 - windowHeight / 2);
+    if (isVisible)
+    {
+        glfwSetWindowPos(window, screenWidth / 2 - windowWidth / 2, screenHeight / 2 - windowHeight / 2);
+    }
     if (glfwRawMouseMotionSupported())
     {
         glfwSetInputMode(window, GLFW_RAW_MOUSE_MOTION, GLFW_TRUE);
@@ -303,7 +457,290 @@ void InitializeOpenGL(GLFWwindow* window)
 
 void InitializePhysics()
 {
-    g_PhysicsScene = new PhysicsScene();
+    g_PhysicsScene = new PhysicsScene(*g_ThreadPool, g_PhysicsBroadPhase);
+    g_PhysicsScene->SetPipelined(g_IsPhysicsPipelined);
+    g_PhysicsScene->SetFixedTimeStep(1.0f / g_PhysicsStepsPerSecond, g_PhysicsMaxSubsteps);
+}
+
+void InitializeThreadPool()
+{
+    const auto workerCount = g_WorkerThreadCount > 0 ? g_WorkerThreadCount : ThreadPool::DefaultWorkerCount();
+    g_ThreadPool = new ThreadPool(workerCount, g_IsWorkerPinningEnabled);
+    std::clog << "ThreadPool: " << workerCount << " workers" << (g_IsWorkerPinningEnabled ? ", pinned" : "") << '\n';
+
+    g_RenderThreadId = std::this_thread::get_id();
+    g_DrawPacketArenas.resize(g_ThreadPool->WorkerCount() + 1);
+    for (u32 i = 0; i < g_ThreadPool->WorkerCount(); i++)
+    {
+        g_DrawPacketQueues.push_back(std::make_unique<SpscQueue<DrawPacketSpan, 64>>());
+    }
+}
+
+// runs on the render thread, only what a changed file feeds into is rebuilt. A failed reload keeps the previous version
+void ReloadChangedAssets()
+{
+    PROFILE_FUNCTION();
+
+    const std::array<Program*, 13> programs
+    {
+        g_FinalProgram,
+        g_GeometryProgram,
+        g_MotionBlurProgram,
+        g_MotionBlurUpsampleProgram,
+        g_MotionBlurTileMaxProgram,
+        g_MotionBlurNeighborMaxProgram,
+        g_LightProgram,
+        g_QuadProgram,
+        g_EmissionProgram,
+        g_InstanceCullProgram,
+        g_HierarchicalZBufferProgram,
+        g_UpscaleProgram,
+        g_PostProgram
+    };
+    const std::array<std::pair<Geometry**, std::string_view>, 2> meshes
+    {
+        std::make_pair(&g_ShipGeometry, kShipModelFilePath),
+        std::make_pair(&g_PointLightGeometry, kPointLightModelFilePath)
+    };
+
+    for (const auto& change : g_FileWatcher->PollChanges())
+    {
+        if (change.Status == FileStatus::Erased)
+        {
+            continue;
+        }
+
+        const auto filePath = std::filesystem::path(change.Path).lexically_normal();
+        try
+        {
+            for (auto program : programs)
+            {
+                if (program->DependsOn(filePath))
+                {
+                    program->Reload();
+                }
+            }
+
+            if (std::find(kSkyboxFilePaths.begin(), kSkyboxFilePaths.end(), filePath.generic_string()) != kSkyboxFilePaths.end())
+            {
+                const auto skyboxTextureCube = TextureCube::FromFiles(kSkyboxFilePaths);
+                delete g_SkyboxTextureCube;
+                g_SkyboxTextureCube = skyboxTextureCube;
+                std::clog << "HotReload: " << filePath.generic_string() << '\n';
+            }
+
+            if (g_Scene_Current != nullptr && g_Scene_Current->ReloadTexture(filePath))
+            {
+                std::clog << "HotReload: " << filePath.generic_string() << '\n';
+            }
+
+            for (auto [geometry, meshFilePath] : meshes)
+            {
+                if (filePath.generic_string() == meshFilePath)
+                {
+                    const auto reloadedGeometry = Geometry::CreateFromFile(meshFilePath);
+                    delete *geometry;
+                    *geometry = reloadedGeometry;
+                    std::clog << "HotReload: " << filePath.generic_string() << '\n';
+                }
+            }
+        }
+        catch (const std::exception& exception)
+        {
+            std::cerr << "HotReload: " << filePath.generic_string() << " failed, " << exception.what() << '\n';
+        }
+    }
+}
+
+Geometry* GetShapeGeometry(const Shape shape)
+{
+    switch (shape)
+    {
+        case Shape::Cube: return g_CubeGeometry;
+        case Shape::CubeInstanced: return g_CubeGeometry;
+        case Shape::Quad: return g_PlaneGeometry;
+        case Shape::Ship: return g_ShipGeometry;
+    }
+
+    return nullptr;
+}
+
+// index into g_DrawPacketArenas and g_DrawPacketQueues, WorkerCount() for the render thread
+u32 CurrentDrawPacketSlot()
+{
+    const auto workerIndex = ThreadPool::CurrentWorkerIndex();
+    if (workerIndex != ThreadPool::NotAWorker)
+    {
+        return workerIndex;
+    }
+
+    assert(std::this_thread::get_id() == g_RenderThreadId && "BuildDrawPackets: only workers and the render thread may run scene jobs");
+    return g_ThreadPool->WorkerCount();
+}
+
+// bounds, frustum and occlusion culling and the sort keys of the objects in [begin, end), runs on a worker
+// or on the render thread while it waits on the pool
+void BuildDrawPackets(const u32 begin, const u32 end, const u32 programId, const glm::mat4& viewProjection)
+{
+    PROFILE_FUNCTION();
+    auto& objects = g_Scene_Current->Objects();
+    const auto slot = CurrentDrawPacketSlot();
+    auto& arena = g_DrawPacketArenas[slot];
+    const auto firstPacket = arena.size();
+
+    const auto pushPacket = [&](const u32 objectIndex)
+    {
+        const auto& object = objects[objectIndex];
+        const auto clipPosition = viewProjection * object->ModelViewProjection[3];
+        const auto depth = clipPosition.w > 0.0f
+            ? clipPosition.z / clipPosition.w * 0.5f + 0.5f
+            : 0.0f;
+
+        arena.push_back({
+            RenderQueue::MakeKey(
+                object->ObjectShape == Shape::CubeInstanced ? RenderPass::Instanced : RenderPass::Opaque,
+                programId,
+                object->ObjectMaterial->Id(),
+                static_cast<u32>(object->ObjectShape),
+                depth),
+            objectIndex });
+    };
+
+    std::array<f32, kSceneJobChunkSize> minX;
+    std::array<f32, kSceneJobChunkSize> minY;
+    std::array<f32, kSceneJobChunkSize> minZ;
+    std::array<f32, kSceneJobChunkSize> maxX;
+    std::array<f32, kSceneJobChunkSize> maxY;
+    std::array<f32, kSceneJobChunkSize> maxZ;
+    std::array<u32, kSceneJobChunkSize> candidates;
+    std::array<u32, kSceneJobChunkSize> visible;
+
+    u32 candidateCount = 0;
+    for (auto objectIndex = begin; objectIndex < end; objectIndex++)
+    {
+        const auto& object = objects[objectIndex];
+        if (object->ObjectShape == Shape::CubeInstanced)
+        {
+            // instances are culled individually on the gpu, keep the object itself always visible
+            pushPacket(objectIndex);
+            continue;
+        }
+
+        const auto bounds = GetShapeGeometry(object->ObjectShape)->Bounds().Transform(object->ModelViewProjection);
+        minX[candidateCount] = bounds.Min.x;
+        minY[candidateCount] = bounds.Min.y;
+        minZ[candidateCount] = bounds.Min.z;
+        maxX[candidateCount] = bounds.Max.x;
+        maxY[candidateCount] = bounds.Max.y;
+        maxZ[candidateCount] = bounds.Max.z;
+        candidates[candidateCount++] = objectIndex;
+    }
+
+    const auto visibleCount = g_Frustum.CullBoxes(
+        minX.data(), minY.data(), minZ.data(),
+        maxX.data(), maxY.data(), maxZ.data(),
+        candidateCount,
+        visible.data());
+    for (u32 i = 0; i < visibleCount; i++)
+    {
+        const auto candidate = visible[i];
+        // tested against last frame's depth, only objects hidden behind what was drawn back then are removed
+        if (g_IsOcclusionCullingEnabled && !g_HierarchicalZBuffer->IsBoxVisible(BoundingBox{
+            glm::vec3(minX[candidate], minY[candidate], minZ[candidate]),
+            glm::vec3(maxX[candidate], maxY[candidate], maxZ[candidate]) }))
+        {
+            continue;
+        }
+
+        pushPacket(candidates[candidate]);
+    }
+
+    // the arena was reserved for every object of the scene, the packets stay in place until the next frame
+    const auto packetCount = static_cast<u32>(arena.size() - firstPacket);
+    if (packetCount > 0 && slot == g_ThreadPool->WorkerCount())
+    {
+        // the consumer itself, waiting for room in a queue only it drains would never end
+        g_GeometryRenderQueue.Append(arena.data() + firstPacket, packetCount);
+    }
+    else if (packetCount > 0)
+    {
+        auto& queue = *g_DrawPacketQueues[slot];
+        while (!queue.TryPush({ arena.data() + firstPacket, packetCount }))
+        {
+            std::this_thread::yield();
+        }
+    }
+}
+
+// Runs the scene update and then, in chunks across the workers, bounds, culling and draw packet building.
+// The render thread is free for gpu work until CollectDrawPackets, nothing else may touch the scene meanwhile
+void StartSceneJobs(const f32 deltaTime, const Camera& camera, const glm::mat4& viewProjection)
+{
+    PROFILE_FUNCTION();
+    // the update moves objects, it does not add or remove any
+    const auto objectCount = static_cast<u32>(g_Scene_Current->Objects().size());
+    // cleared before the jobs start, the render thread appends the packets of the jobs it runs right away
+    g_GeometryRenderQueue.Clear();
+    for (auto& arena : g_DrawPacketArenas)
+    {
+        arena.clear();
+        arena.reserve(objectCount);
+    }
+
+    const auto programId = g_GeometryProgram->GetId();
+
+    g_SceneJobs.Clear();
+    const auto sceneUpdate = g_SceneJobs.Add([deltaTime, camera]()
+    {
+        g_Scene_Current->Update(deltaTime, camera);
+    });
+    for (u32 begin = 0; begin < objectCount; begin += kSceneJobChunkSize)
+    {
+        const auto end = std::min(begin + kSceneJobChunkSize, objectCount);
+        g_SceneJobs.Add([begin, end, programId, viewProjection]()
+        {
+            BuildDrawPackets(begin, end, programId, viewProjection);
+        }, { sceneUpdate });
+    }
+    g_SceneJobs.Start(*g_ThreadPool);
+}
+
+// merges the packets into the render queue as they arrive and sorts them once all jobs are done
+void CollectDrawPackets()
+{
+    PROFILE_FUNCTION();
+    const auto drainQueues = []()
+    {
+        DrawPacketSpan span{};
+        for (auto& queue : g_DrawPacketQueues)
+        {
+            while (queue->TryPop(span))
+            {
+                g_GeometryRenderQueue.Append(span.Items, span.Count);
+            }
+        }
+    };
+
+    while (!g_SceneJobs.IsDone())
+    {
+        drainQueues();
+        std::this_thread::yield();
+    }
+    g_SceneJobs.Wait();
+    drainQueues();
+
+    g_GeometryRenderQueue.Sort();
+}
+
+void CullInstances(const glm::vec3& cameraPosition)
+{
+    GpuProfileScope profileScope(*g_GpuProfiler, 7, "Cull Instances");
+
+    g_AsteroidCuller->Cull(
+        g_Frustum,
+        cameraPosition,
+        g_AsteroidCullDistance,
+        g_IsOcclusionCullingEnabled ? g_HierarchicalZBuffer : nullptr);
 }
 
 void RenderGBuffer(
@@ -312,8 +749,8 @@ void RenderGBuffer(
     const glm::mat4& cameraProjection,
     const glm::mat4& cameraView)
 {
-    constexpr std::string_view renderGBufferDebugGroup = "Render GBuffer";
-    glPushDebugGroup(GL_DEBUG_SOURCE_APPLICATION, 1, static_cast<GLsizei>(renderGBufferDebugGroup.length()), renderGBufferDebugGroup.data());
+    PROFILE_FUNCTION();
+    GpuProfileScope profileScope(*g_GpuProfiler, 1, "Render GBuffer");
     auto constexpr depthClearValue = 1.0f;
     g_GeometryFramebuffer->Clear(0, glm::value_ptr(glm::vec3(0.0f)));
     g_GeometryFramebuffer->Clear(1, glm::value_ptr(glm::vec3(0.0f)));
@@ -324,62 +761,146 @@ void RenderGBuffer(
     g_GeometryFramebuffer->Bind();
     glViewport(0, 0, frameWidth, frameHeight);
 
-    g_GeometryProgram->Bind();
-    //std::sort(g_Scene_Current->Objects().begin(), g_Scene_Current->Objects().end());
-        
     ///////////////////////// SCENE RENDER BEGIN /////////////////////////
     //TODO(deccer): move to spacescene.cpp
-    for (auto& object : g_Scene_Current->Objects())
+    auto& objects = g_Scene_Current->Objects();
+    const auto viewProjection = cameraProjection * cameraView;
+
+    CollectDrawPackets();
+
+    // objects sharing pass, program, material and geometry are adjacent after sorting and become one instanced draw
+    g_GeometryInstanceBatcher.Begin();
+    for (const auto& item : g_GeometryRenderQueue.Items())
     {
-        object->ObjectMaterial->Apply();
-        switch (object->ObjectShape)
+        auto& object = objects[item.Payload];
+        if (object->ObjectShape == Shape::CubeInstanced)
         {
-            case Shape::Cube: g_CubeGeometry->Bind(); break;
-            case Shape::CubeInstanced:
+            object->ExcludeFromMotionBlur = true;
+        }
+
+        auto const currentModelViewProjection = viewProjection * object->ModelViewProjection;
+        g_GeometryInstanceBatcher.Add(
+            item.Key >> RenderQueue::GeometryShift,
+            item.Payload,
+            object->ModelViewProjection,
+            object->ExcludeFromMotionBlur ? currentModelViewProjection : object->ModelViewProjectionPrevious);
+
+        object->ModelViewProjectionPrevious = currentModelViewProjection;
+    }
+    g_GeometryInstanceBatcher.Upload(*g_FrameDataRing);
+
+    auto& statistics = g_GeometryRenderQueue.Statistics();
+    // start from values no real key can hold so the first draw binds everything
+    auto currentPermutation = ~0u;
+    auto currentMaterial = ~0u;
+    auto currentGeometry = ~0u;
+    auto isBatchBufferBound = false;
+    for (const auto& batch : g_GeometryInstanceBatcher.Batches())
+    {
+        auto& object = objects[batch.Payload];
+        const auto batchKey = batch.Key << RenderQueue::GeometryShift;
+        const auto material = RenderQueue::Material(batchKey);
+        const auto geometry = RenderQueue::Geometry(batchKey);
+        const auto isInstanced = RenderQueue::Pass(batchKey) == static_cast<u32>(RenderPass::Instanced);
+        // batched objects that are excluded from motion blur carry their current matrix as the previous one
+        const auto permutation = isInstanced
+            ? kGeometryPermutationInstanced | (object->ExcludeFromMotionBlur ? kGeometryPermutationExcludeFromMotionBlur : 0u)
+            : 0u;
+
+        if (permutation != currentPermutation)
+        {
+            g_GeometryProgram->SetPermutation(permutation);
+            if (!g_GeometryProgram->IsReady())
             {
-                g_CubeGeometry->Bind();
-                //g_Buffer_Asteroids->BindAsStorageBuffer();
-                reinterpret_cast<SpaceScene*>(g_Scene_Current)->GetAsteroidInstanceBuffer()->BindAsStorageBuffer(0);
-                object->ExcludeFromMotionBlur = true;
-                break;
+                // the variant is still compiling, its objects show up a few frames later. Forget the
+                // bound one as well, the program no longer selects it
+                currentPermutation = ~0u;
+                continue;
             }
-            case Shape::Ship: g_ShipGeometry->Bind(); break;
-            case Shape::Quad: g_PlaneGeometry->Bind(); break;
-        }
 
-        auto const currentModelViewProjection = cameraProjection * cameraView * object->ModelViewProjection;
+            g_GeometryProgram->Bind();
+            currentPermutation = permutation;
+            statistics.ProgramChanges++;
+        }
+        else
+        {
+            statistics.ProgramChangesAvoided++;
+        }
 
-        g_GeometryProgram->SetVertexShaderUniform(2, object->ModelViewProjection);
-        g_GeometryProgram->SetVertexShaderUniform(3, currentModelViewProjection);
-        g_GeometryProgram->SetVertexShaderUniform(4, object->ModelViewProjectionPrevious);
-        g_GeometryProgram->SetVertexShaderUniform(5, object->ExcludeFromMotionBlur);
-        g_GeometryProgram->SetVertexShaderUniform(6, object->ObjectShape == Shape::CubeInstanced);
+        if (material != currentMaterial)
+        {
+            object->ObjectMaterial->Apply();
+            currentMaterial = material;
+            statistics.MaterialChanges++;
+        }
+        else
+        {
+            statistics.MaterialChangesAvoided++;
+        }
 
-        object->ModelViewProjectionPrevious = currentModelViewProjection;
+        if (geometry != currentGeometry)
+        {
+            switch (object->ObjectShape)
+            {
+                case Shape::Cube: g_CubeGeometry->Bind(); break;
+                case Shape::CubeInstanced:
+                {
+                    g_CubeGeometry->Bind();
+                    reinterpret_cast<SpaceScene*>(g_Scene_Current)->GetAsteroidInstanceBuffer()->BindAsStorageBuffer(0);
+                    g_AsteroidCuller->BindVisibleInstances(1);
+                    isBatchBufferBound = false;
+                    break;
+                }
+                case Shape::Ship: g_ShipGeometry->Bind(); break;
+                case Shape::Quad: g_PlaneGeometry->Bind(); break;
+            }
+            currentGeometry = geometry;
+            statistics.GeometryChanges++;
+        }
+        else
+        {
+            statistics.GeometryChangesAvoided++;
+        }
 
-        switch (object->ObjectShape)
+        if (isInstanced)
         {
-            case Shape::Cube: g_CubeGeometry->Draw(); break;
-            //case Shape::CubeInstanced: glDrawElementsInstancedBaseVertex(GL_TRIANGLES, 36, GL_UNSIGNED_INT, nullptr, 5000, 0); break;
-            case Shape::CubeInstanced: g_CubeGeometry->DrawInstanced(5000); break;
-            case Shape::Quad: g_PlaneGeometry->Draw(); break;
-            case Shape::Ship: g_ShipGeometry->Draw(); break;
+            // the matrix was already advanced while batching and holds this frame's transform
+            g_GeometryProgram->SetVertexShaderUniform(3, object->ModelViewProjectionPrevious);
+            g_GeometryProgram->SetVertexShaderUniform(4, object->ModelViewProjectionPrevious);
+            g_CubeGeometry->DrawIndirect(g_AsteroidCuller->DrawCommandBuffer());
         }
+        else
+        {
+            if (!isBatchBufferBound)
+            {
+                g_GeometryInstanceBatcher.Bind(*g_FrameDataRing, 0, 2);
+                isBatchBufferBound = true;
+            }
+
+            g_GeometryProgram->SetVertexShaderUniform(8, static_cast<s32>(batch.FirstInstance));
+            GetShapeGeometry(object->ObjectShape)->DrawInstanced(batch.InstanceCount);
+        }
+        statistics.DrawCount++;
+        statistics.InstanceCount += batch.InstanceCount;
     }
-    glPopDebugGroup();
+}
+
+void BuildHierarchicalZBuffer(const glm::ivec2& renderSize, const glm::mat4& viewProjection)
+{
+    GpuProfileScope profileScope(*g_GpuProfiler, 8, "Build HZB");
+
+    g_HierarchicalZBuffer->Build(*g_gBufferDepthTexture, renderSize, viewProjection);
 }
 
 void RenderLights(
     const Texture& gBufferPosition,
     const Texture& gBufferNormal,
     const Texture& gBufferDepth,
-    const glm::mat4& cameraProjection,
-    const glm::vec3& cameraPosition,
     const glm::vec3& /*cameraDirection*/,
     int& visibleLights)
 {
-    constexpr std::string_view renderLightBufferDebugGroup = "Render LBuffer";
-    glPushDebugGroup(GL_DEBUG_SOURCE_APPLICATION, 2, static_cast<GLsizei>(renderLightBufferDebugGroup.length()), renderLightBufferDebugGroup.data());
+    PROFILE_FUNCTION();
+    GpuProfileScope profileScope(*g_GpuProfiler, 2, "Render LBuffer");
 
     auto constexpr depthClearValue = 1.0f;
     g_LightsFramebuffer->Clear(0, glm::value_ptr(glm::vec3(0.0f)));
@@ -390,7 +911,6 @@ void RenderLights(
     gBufferNormal.Bind(1);
     gBufferDepth.Bind(2);
 
-    g_LightProgram->Bind();
     g_PointLightGeometry->Bind();
 
     glCullFace(GL_FRONT);
@@ -398,39 +918,71 @@ void RenderLights(
     glBlendFunc(GL_ONE, GL_ONE);
     //glBlendFunc(GL_SRC_ALPHA, GL_ONE);
 
-    auto lightIndex = 0;
-    visibleLights = 0;
+    g_VisibleLightData.clear();
 
     auto& lights = g_Scene_Current->Lights();
     for (auto& light : lights)
     {
-        lightIndex++;
-
         if (!g_Frustum.SphereInFrustum(light.Position.x, light.Position.y, light.Position.z, light.Attenuation.z))
         {
             continue;
         }
 
-        visibleLights++;
+        if (g_IsOcclusionCullingEnabled && !g_HierarchicalZBuffer->IsSphereVisible(light.Position, light.Attenuation.z))
+        {
+            continue;
+        }
+
         auto model = glm::translate(glm::mat4(1.0f), glm::vec3(light.Position));
         model = glm::scale(model, glm::vec3(light.Attenuation.z, light.Attenuation.z, light.Attenuation.z));
-        g_LightProgram->SetVertexShaderUniform(0, cameraProjection);
-        g_LightProgram->SetVertexShaderUniform(1, g_Camera_View);
-        g_LightProgram->SetVertexShaderUniform(2, model);
 
-        g_LightProgram->SetFragmentShaderUniform(0, static_cast<s32>(light.Type));
-        g_LightProgram->SetFragmentShaderUniform(1, light.Position);
-        g_LightProgram->SetFragmentShaderUniform(2, light.Color);
-        g_LightProgram->SetFragmentShaderUniform(3, light.Direction);
-        g_LightProgram->SetFragmentShaderUniform(4, light.Attenuation);
-        g_LightProgram->SetFragmentShaderUniform(5, light.CutOff);
-        g_LightProgram->SetFragmentShaderUniform(6, cameraPosition);
+        g_VisibleLightData.push_back(LightData
+        {
+            model,
+            glm::vec4(light.Position, 1.0f),
+            glm::vec4(light.Color, 1.0f),
+            glm::vec4(light.Direction, 0.0f),
+            glm::vec4(light.Attenuation, 0.0f),
+            glm::vec4(light.CutOff, 0.0f, 0.0f),
+            glm::ivec4(static_cast<s32>(light.Type), 0, 0, 0)
+        });
+    }
+
+    visibleLights = static_cast<int>(g_VisibleLightData.size());
+
+    // one instanced draw per light type, each with the program variant specialized for it, the shaders
+    // index the light records of their draw by instance
+    const auto spotLights = std::partition(g_VisibleLightData.begin(), g_VisibleLightData.end(), [](const LightData& lightData)
+    {
+        return lightData.Type.x != static_cast<s32>(LightType::SpotLight);
+    });
+    const auto spotLightIndex = static_cast<u32>(spotLights - g_VisibleLightData.begin());
+    const std::array<std::pair<u32, u32>, 2> lightRanges
+    {
+        std::make_pair(0u, spotLightIndex),
+        std::make_pair(spotLightIndex, static_cast<u32>(g_VisibleLightData.size()))
+    };
+
+    for (std::size_t lightType = 0; lightType < lightRanges.size(); lightType++)
+    {
+        const auto [first, last] = lightRanges[lightType];
+        if (first == last)
+        {
+            continue;
+        }
+
+        g_LightProgram->SetPermutation(lightType == 1 ? kLightPermutationSpotLight : 0u);
+        if (!g_LightProgram->IsReady())
+        {
+            continue;
+        }
 
-        glDrawArraysInstancedBaseInstance(GL_TRIANGLES, 0, 240, 1, 0);
+        g_LightProgram->Bind();
+        g_FrameDataRing->BindAsStorageBuffer(3, g_FrameDataRing->Write(g_VisibleLightData.data() + first, (last - first) * static_cast<u32>(sizeof(LightData))));
+        glDrawArraysInstancedBaseInstance(GL_TRIANGLES, 0, 240, static_cast<GLsizei>(last - first), 0);
     }
     glDisable(GL_BLEND);
     glCullFace(GL_BACK);
-    glPopDebugGroup();
 }
 
 // TODO(deccer): pass Camera, remove frameWidth/frameHeight/fieldOfView
@@ -444,19 +996,24 @@ void ResolveGBuffer(
     const Texture& emissionTexture,
     const int frameWidth,
     const int frameHeight,
-    const float fieldOfView)
+    const float fieldOfView,
+    const glm::vec2& uvScale)
 {
     auto constexpr kUniformCameraDirection = 0;
     auto constexpr kUniformCameraFieldOfView = 1;
     auto constexpr kUniformCameraAspectRatio = 2;
     auto constexpr kUniformUvsDiff = 3;
 
-    constexpr std::string_view resolveGBufferDebugGroup = "Resolve GBuffer";
-    glPushDebugGroup(GL_DEBUG_SOURCE_APPLICATION, 3, static_cast<GLsizei>(resolveGBufferDebugGroup.length()), resolveGBufferDebugGroup.data());
+    GpuProfileScope profileScope(*g_GpuProfiler, 3, "Resolve GBuffer");
 
-    g_FinalFramebuffer->Clear(0, glm::value_ptr(glm::vec3(1.0f)));
+    // black, a frame whose program is still compiling stays dark instead of flashing up
+    g_FinalFramebuffer->Clear(0, glm::value_ptr(glm::vec3(0.0f)));
     g_FinalFramebuffer->ClearDepth(1.0f);
     g_FinalFramebuffer->Bind();
+    if (!g_FinalProgram->IsReady())
+    {
+        return;
+    }
 
     gBufferPosition.Bind(0);
     gBufferNormal.Bind(1);
@@ -471,19 +1028,64 @@ void ResolveGBuffer(
     g_FinalProgram->SetVertexShaderUniform(kUniformCameraDirection, glm::inverse(glm::mat3(g_Camera_View)));
     g_FinalProgram->SetVertexShaderUniform(kUniformCameraFieldOfView, fieldOfView);
     g_FinalProgram->SetVertexShaderUniform(kUniformCameraAspectRatio, static_cast<f32>(frameWidth) / static_cast<f32>(frameHeight));
-    g_FinalProgram->SetVertexShaderUniform(kUniformUvsDiff, glm::vec2(1.0f, 1.0f));
+    g_FinalProgram->SetVertexShaderUniform(kUniformUvsDiff, uvScale);
 
     glDrawArraysInstancedBaseInstance(GL_TRIANGLES, 0, 6, 1, 0);
-    glPopDebugGroup();
+}
+
+void ResolveGBufferFused(
+    const TextureCube& skyboxTextureCube,
+    const Texture& gBufferAlbedo,
+    const Texture& gBufferDepth,
+    const Texture& lightBufferTexture,
+    const int frameWidth,
+    const int frameHeight,
+    const float fieldOfView,
+    const glm::ivec2& renderSize,
+    const glm::vec4& transitionFactor)
+{
+    auto constexpr kUniformCameraDirection = 0;
+    auto constexpr kUniformCameraFieldOfView = 1;
+    auto constexpr kUniformCameraAspectRatio = 2;
+    auto constexpr kUniformRenderSize = 3;
+    auto constexpr kUniformBlendColor = 4;
+    auto constexpr kWorkGroupSize = 8;
+
+    GpuProfileScope profileScope(*g_GpuProfiler, 11, "Fused Post");
+    if (!g_PostProgram->IsReady())
+    {
+        // the dispatch writes every pixel, without it the final texture would still hold an older frame
+        g_FinalFramebuffer->Clear(0, glm::value_ptr(glm::vec3(0.0f)));
+        return;
+    }
+
+    lightBufferTexture.Bind(0);
+    gBufferAlbedo.Bind(1);
+    gBufferDepth.Bind(2);
+    skyboxTextureCube.Bind(3);
+    glBindImageTexture(0, g_gBufferFinalTexture->Id(), 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA8);
+
+    g_PostProgram->Bind();
+    g_PostProgram->SetComputeShaderUniform(kUniformCameraDirection, glm::inverse(glm::mat3(g_Camera_View)));
+    g_PostProgram->SetComputeShaderUniform(kUniformCameraFieldOfView, fieldOfView);
+    g_PostProgram->SetComputeShaderUniform(kUniformCameraAspectRatio, static_cast<f32>(frameWidth) / static_cast<f32>(frameHeight));
+    g_PostProgram->SetComputeShaderUniform(kUniformRenderSize, renderSize);
+    g_PostProgram->SetComputeShaderUniform(kUniformBlendColor, transitionFactor.w > 0.0f ? transitionFactor : glm::vec4(0.0f));
+
+    glDispatchCompute((renderSize.x + kWorkGroupSize - 1) / kWorkGroupSize, (renderSize.y + kWorkGroupSize - 1) / kWorkGroupSize, 1);
+    glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
 }
 
 void RenderEmission(const Texture& lightBufferTexture, const Texture& emissionTexture)
 {
-    constexpr std::string_view renderEmissionDebugGroup = "Render Emission";
-    glPushDebugGroup(GL_DEBUG_SOURCE_APPLICATION, 4, static_cast<GLsizei>(renderEmissionDebugGroup.length()), renderEmissionDebugGroup.data());
+    GpuProfileScope profileScope(*g_GpuProfiler, 4, "Render Emission");
 
     g_EmissionFramebuffer->Clear(0, glm::value_ptr(glm::vec3(0.0f)));
     g_EmissionFramebuffer->Bind();
+    if (!g_EmissionProgram->IsReady())
+    {
+        return;
+    }
 
     lightBufferTexture.Bind(0);
     emissionTexture.Bind(1);
@@ -493,11 +1095,140 @@ void RenderEmission(const Texture& lightBufferTexture, const Texture& emissionTe
     g_EmissionProgram->SetFragmentShaderUniform(0, 0.7f);
 
     glDrawArraysInstancedBaseInstance(GL_TRIANGLES, 0, 6, 1, 0);
-    glPopDebugGroup();
 }
 
-int main(int /*argc*/, char** /*argv*/)
+void ParseCommandLine(const int argc, char** argv)
+{
+    for (auto i = 1; i < argc; i++)
+    {
+        const std::string_view argument = argv[i];
+
+        constexpr std::string_view framesInFlightArgument = "--frames-in-flight=";
+        if (argument.substr(0, framesInFlightArgument.length()) == framesInFlightArgument)
+        {
+            const auto depth = std::strtoul(argv[i] + framesInFlightArgument.length(), nullptr, 10);
+            g_FramesInFlightDepth = static_cast<u32>(std::clamp(depth, 1ul, 4ul));
+        }
+        else if (constexpr std::string_view cpuTraceArgument = "--cpu-trace="; argument.substr(0, cpuTraceArgument.length()) == cpuTraceArgument)
+        {
+            g_CpuTraceFilePath = argument.substr(cpuTraceArgument.length());
+        }
+        else if (constexpr std::string_view targetFrameTimeArgument = "--target-frame-time="; argument.substr(0, targetFrameTimeArgument.length()) == targetFrameTimeArgument)
+        {
+            const auto targetFrameMilliseconds = std::strtof(argv[i] + targetFrameTimeArgument.length(), nullptr);
+            if (targetFrameMilliseconds > 0.0f)
+            {
+                g_TargetFrameMilliseconds = targetFrameMilliseconds;
+            }
+        }
+        else if (argument == "--no-dynamic-resolution")
+        {
+            g_IsDynamicResolutionEnabled = false;
+        }
+        else if (constexpr std::string_view physicsRateArgument = "--physics-rate="; argument.substr(0, physicsRateArgument.length()) == physicsRateArgument)
+        {
+            const auto stepsPerSecond = std::strtof(argv[i] + physicsRateArgument.length(), nullptr);
+            if (stepsPerSecond > 0.0f)
+            {
+                g_PhysicsStepsPerSecond = stepsPerSecond;
+            }
+        }
+        else if (constexpr std::string_view physicsMaxSubstepsArgument = "--physics-max-substeps="; argument.substr(0, physicsMaxSubstepsArgument.length()) == physicsMaxSubstepsArgument)
+        {
+            const auto maxSubsteps = std::strtoul(argv[i] + physicsMaxSubstepsArgument.length(), nullptr, 10);
+            if (maxSubsteps > 0)
+            {
+                g_PhysicsMaxSubsteps = static_cast<u32>(maxSubsteps);
+            }
+        }
+        else if (constexpr std::string_view workerThreadsArgument = "--worker-threads="; argument.substr(0, workerThreadsArgument.length()) == workerThreadsArgument)
+        {
+            // PhysX hands its tasks to the pool and waits for them, it needs at least one worker
+            const auto workerCount = std::strtoul(argv[i] + workerThreadsArgument.length(), nullptr, 10);
+            if (workerCount > 0)
+            {
+                g_WorkerThreadCount = static_cast<u32>(workerCount);
+            }
+        }
+        else if (argument == "--pin-worker-threads")
+        {
+            g_IsWorkerPinningEnabled = true;
+        }
+        else if (constexpr std::string_view physicsBroadPhaseArgument = "--physics-broadphase="; argument.substr(0, physicsBroadPhaseArgument.length()) == physicsBroadPhaseArgument)
+        {
+            const auto broadPhase = argument.substr(physicsBroadPhaseArgument.length());
+            if (broadPhase == "sap")
+            {
+                g_PhysicsBroadPhase = physx::PxBroadPhaseType::eSAP;
+            }
+            else if (broadPhase == "mbp")
+            {
+                g_PhysicsBroadPhase = physx::PxBroadPhaseType::eMBP;
+            }
+            else if (broadPhase == "abp")
+            {
+                g_PhysicsBroadPhase = physx::PxBroadPhaseType::eABP;
+            }
+            else
+            {
+                std::cerr << "PHYSX: Unknown broadphase " << broadPhase << ", expected sap, mbp or abp.\n";
+            }
+        }
+        else if (argument == "--no-pipelined-physics")
+        {
+            g_IsPhysicsPipelined = false;
+        }
+        else if (argument == "--no-hot-reload")
+        {
+            g_IsHotReloadEnabled = false;
+        }
+        else if (argument == "--fused-post")
+        {
+            g_IsFusedPostEnabled = true;
+        }
+        else if (argument == "--motion-blur-half-resolution")
+        {
+            g_IsMotionBlurHalfResolution = true;
+        }
+        else if (argument == "--benchmark")
+        {
+            g_IsBenchmarkEnabled = true;
+        }
+        else if (constexpr std::string_view benchmarkFramesArgument = "--benchmark-frames="; argument.substr(0, benchmarkFramesArgument.length()) == benchmarkFramesArgument)
+        {
+            g_BenchmarkSettings.FrameCount = std::max(1u, static_cast<u32>(std::strtoul(argv[i] + benchmarkFramesArgument.length(), nullptr, 10)));
+        }
+        else if (constexpr std::string_view benchmarkResolutionArgument = "--benchmark-resolution="; argument.substr(0, benchmarkResolutionArgument.length()) == benchmarkResolutionArgument)
+        {
+            char* heightStart = nullptr;
+            const auto width = std::strtoul(argv[i] + benchmarkResolutionArgument.length(), &heightStart, 10);
+            const auto height = *heightStart == 'x' ? std::strtoul(heightStart + 1, nullptr, 10) : 0ul;
+            if (width > 0 && height > 0)
+            {
+                g_BenchmarkSettings.Width = static_cast<u32>(width);
+                g_BenchmarkSettings.Height = static_cast<u32>(height);
+            }
+            else
+            {
+                std::clog << "Ignoring malformed " << argument << ", expected WIDTHxHEIGHT\n";
+            }
+        }
+        else if (constexpr std::string_view benchmarkReportArgument = "--benchmark-report="; argument.substr(0, benchmarkReportArgument.length()) == benchmarkReportArgument)
+        {
+            g_BenchmarkSettings.ReportFilePath = std::string(argument.substr(benchmarkReportArgument.length()));
+        }
+        else
+        {
+            std::clog << "Ignoring unknown argument " << argument << '\n';
+        }
+    }
+}
+
+int main(int argc, char** argv)
 {
+    PROFILE_THREAD("Main");
+    ParseCommandLine(argc, argv);
+
     if (!glfwInit())
     {
         std::cerr << "GLFW: Unable to initialize.\n";
@@ -506,12 +1237,22 @@ int main(int /*argc*/, char** /*argv*/)
 
     s32 screenWidth{};
     s32 screenHeight{};
-    GetWorkingArea(&screenWidth, &screenHeight);
-
-    const auto windowWidth = static_cast<u32>(0.8f * screenWidth);
-    const auto windowHeight = static_cast<u32>(0.8f * screenHeight);
+    u32 windowWidth{};
+    u32 windowHeight{};
+    if (g_IsBenchmarkEnabled)
+    {
+        // no monitor is needed, the resolution is part of what is being compared
+        windowWidth = g_BenchmarkSettings.Width;
+        windowHeight = g_BenchmarkSettings.Height;
+    }
+    else
+    {
+        GetWorkingArea(&screenWidth, &screenHeight);
+        windowWidth = static_cast<u32>(0.8f * screenWidth);
+        windowHeight = static_cast<u32>(0.8f * screenHeight);
+    }
 
-    g_Window = CreateMainWindow(screenWidth, screenHeight, windowWidth, windowHeight, "emptyspace");
+    g_Window = CreateMainWindow(screenWidth, screenHeight, windowWidth, windowHeight, "emptyspace", !g_IsBenchmarkEnabled);
     if (g_Window == nullptr)
     {
         std::cerr << "GLFW: Unable to create a window.\n";
@@ -519,56 +1260,54 @@ int main(int /*argc*/, char** /*argv*/)
     }
 
     InitializeOpenGL(g_Window);
-    InitializePhysics();	
+    InitializeThreadPool();
+    InitializePhysics();
 
-    const auto frameWidth = static_cast<s32>(windowWidth * 1.0f);
-    const auto frameHeight = static_cast<s32>(windowHeight * 1.0f);
+    s32 frameWidth{};
+    s32 frameHeight{};
+    glfwGetFramebufferSize(g_Window, &frameWidth, &frameHeight);
 
     const auto graphicsDevice = new GraphicsDevice();
     g_Scene_Current = new SpaceScene(*graphicsDevice);
 
-    g_gBufferFinalTexture = graphicsDevice->CreateTexture(GL_RGB8, GL_RGB, frameWidth, frameHeight, nullptr, GL_NEAREST);
+    g_RenderTargetManager = new RenderTargetManager(*graphicsDevice, glm::ivec2(frameWidth, frameHeight));
+    g_RenderTargetManager->AddTexture(g_gBufferFinalTexture, GL_RGBA8, GL_RGBA, GL_NEAREST);
     
-    g_gBufferPositionTexture = graphicsDevice->CreateTexture(GL_RGBA16F, GL_RGB, frameWidth, frameHeight, nullptr, GL_NEAREST);
-    g_gBufferNormalTexture = graphicsDevice->CreateTexture(GL_RGB16F, GL_RGB, frameWidth, frameHeight, nullptr, GL_NEAREST);
-    g_gBufferAlbedoTexture = graphicsDevice->CreateTexture(GL_RGBA8, GL_RGBA, frameWidth, frameHeight, nullptr, GL_NEAREST);
-    g_gBufferDepthTexture = graphicsDevice->CreateTexture(GL_DEPTH_COMPONENT32, GL_DEPTH, frameWidth, frameHeight, nullptr, GL_NEAREST);
-    g_gBufferVelocityTexture = graphicsDevice->CreateTexture(GL_RG16F, GL_RG, frameWidth, frameHeight, nullptr, GL_NEAREST);
-    g_LightBufferTexture = graphicsDevice->CreateTexture(GL_RGB16F, GL_RGB, frameWidth, frameHeight, nullptr, GL_NEAREST);
-    g_MotionBlurTexture = graphicsDevice->CreateTexture(GL_RGB8, GL_RGB, frameWidth, frameHeight, nullptr, GL_NEAREST);
-    g_TransitionTexture = graphicsDevice->CreateTexture(GL_RGB8, GL_RGB, frameWidth, frameHeight, nullptr, GL_NEAREST);
-    g_EmissionTexture = graphicsDevice->CreateTexture(GL_RGBA16F, GL_RGBA, frameWidth, frameHeight, nullptr, GL_NEAREST);
-
-    g_GeometryFramebuffer = graphicsDevice->CreateFramebuffer("FB_Geometry",
-        {
-            g_gBufferPositionTexture,
-            g_gBufferNormalTexture,
-            g_gBufferAlbedoTexture,
-            g_gBufferVelocityTexture,
-            g_EmissionTexture,
+    g_RenderTargetManager->AddTexture(g_gBufferPositionTexture, GL_RGBA16F, GL_RGB, GL_NEAREST);
+    g_RenderTargetManager->AddTexture(g_gBufferNormalTexture, GL_RGB16F, GL_RGB, GL_NEAREST);
+    g_RenderTargetManager->AddTexture(g_gBufferAlbedoTexture, GL_RGBA8, GL_RGBA, GL_NEAREST);
+    g_RenderTargetManager->AddTexture(g_gBufferDepthTexture, GL_DEPTH_COMPONENT32, GL_DEPTH, GL_NEAREST);
+    g_RenderTargetManager->AddTexture(g_gBufferVelocityTexture, GL_RG16F, GL_RG, GL_NEAREST);
+    g_RenderTargetManager->AddTexture(g_LightBufferTexture, GL_RGB16F, GL_RGB, GL_NEAREST);
+    g_RenderTargetManager->AddTexture(g_MotionBlurTexture, GL_RGB8, GL_RGB, GL_NEAREST);
+    g_RenderTargetManager->AddTexture(g_MotionBlurHalfTexture, GL_RGB8, GL_RGB, GL_NEAREST, 2);
+    g_RenderTargetManager->AddTexture(g_TransitionTexture, GL_RGB8, GL_RGB, GL_NEAREST);
+    g_RenderTargetManager->AddTexture(g_EmissionTexture, GL_RGBA16F, GL_RGBA, GL_NEAREST);
+
+    g_RenderTargetManager->AddFramebuffer(g_GeometryFramebuffer, "FB_Geometry",
+        {
+            &g_gBufferPositionTexture,
+            &g_gBufferNormalTexture,
+            &g_gBufferAlbedoTexture,
+            &g_gBufferVelocityTexture,
+            &g_EmissionTexture,
         },
-        g_gBufferDepthTexture);
-    g_FinalFramebuffer = graphicsDevice->CreateFramebuffer("FB_Final", { g_gBufferFinalTexture });
-    g_EmissionFramebuffer = graphicsDevice->CreateFramebuffer("FB_Emission", { g_EmissionTexture });
-    g_MotionBlurFramebuffer = graphicsDevice->CreateFramebuffer("FB_Motionblur", { g_MotionBlurTexture });
-    g_LightsFramebuffer = graphicsDevice->CreateFramebuffer("FB_Lights", { g_LightBufferTexture });
-    g_TransitionFramebuffer = graphicsDevice->CreateFramebuffer("FB_Transition", { g_TransitionTexture });
-
-    g_SkyboxTextureCube = graphicsDevice->CreateTextureCubeFromFiles({
-    "data/textures/TC_SkySpace_Xn.png",
-    "data/textures/TC_SkySpace_Xp.png",
-    "data/textures/TC_SkySpace_Yn.png",
-    "data/textures/TC_SkySpace_Yp.png",
-    "data/textures/TC_SkySpace_Zn.png",
-    "data/textures/TC_SkySpace_Zp.png"
-        });
+        &g_gBufferDepthTexture);
+    g_RenderTargetManager->AddFramebuffer(g_FinalFramebuffer, "FB_Final", { &g_gBufferFinalTexture });
+    g_RenderTargetManager->AddFramebuffer(g_EmissionFramebuffer, "FB_Emission", { &g_EmissionTexture });
+    g_RenderTargetManager->AddFramebuffer(g_MotionBlurFramebuffer, "FB_Motionblur", { &g_MotionBlurTexture });
+    g_RenderTargetManager->AddFramebuffer(g_MotionBlurHalfFramebuffer, "FB_MotionblurHalf", { &g_MotionBlurHalfTexture });
+    g_RenderTargetManager->AddFramebuffer(g_LightsFramebuffer, "FB_Lights", { &g_LightBufferTexture });
+    g_RenderTargetManager->AddFramebuffer(g_TransitionFramebuffer, "FB_Transition", { &g_TransitionTexture });
+
+    g_SkyboxTextureCube = graphicsDevice->CreateTextureCubeFromFiles(kSkyboxFilePaths);
 
     g_EmptyGeometry = Geometry::CreateEmpty();
     g_CubeGeometry = Geometry::CreateUnitCube();
     //g_CubeGeometry = Geometry::CreateFromFile("data/models/SM_Cube.fbx");
     g_PlaneGeometry = Geometry::CreateUnitPlane();
-    g_ShipGeometry = Geometry::CreateFromFile("data/models/SM_ShipA_noWindshield.obj");
-    g_PointLightGeometry = Geometry::CreateFromFile("data/models/SM_PointLight.obj");
+    g_ShipGeometry = Geometry::CreateFromFile(kShipModelFilePath);
+    g_PointLightGeometry = Geometry::CreateFromFile(kPointLightModelFilePath);
         
     g_FinalProgram = graphicsDevice->CreateProgramFromFiles(
         "PP_Final",
@@ -577,15 +1316,27 @@ int main(int /*argc*/, char** /*argv*/)
     g_GeometryProgram = graphicsDevice->CreateProgramFromFiles(
         "PP_Geometry",
         "data/shaders/gbuffer.vert.glsl",
-        "data/shaders/gbuffer.frag.glsl");
+        "data/shaders/gbuffer.frag.glsl",
+        { "IS_INSTANCED", "EXCLUDE_FROM_MOTIONBLUR" });
     g_MotionBlurProgram = graphicsDevice->CreateProgramFromFiles(
         "PP_MotionBlur",
         "data/shaders/motionblur.vert.glsl",
         "data/shaders/motionblur.frag.glsl");
+    g_MotionBlurUpsampleProgram = graphicsDevice->CreateProgramFromFiles(
+        "PP_MotionBlurUpsample",
+        "data/shaders/motionblur.vert.glsl",
+        "data/shaders/motionblurupsample.frag.glsl");
+    g_MotionBlurTileMaxProgram = graphicsDevice->CreateComputeProgramFromFile(
+        "PP_MotionBlurTileMax",
+        "data/shaders/motionblurtilemax.comp.glsl");
+    g_MotionBlurNeighborMaxProgram = graphicsDevice->CreateComputeProgramFromFile(
+        "PP_MotionBlurNeighborMax",
+        "data/shaders/motionblurneighbormax.comp.glsl");
     g_LightProgram = graphicsDevice->CreateProgramFromFiles(
         "PP_Light",
         "data/shaders/light.vert.glsl",
-        "data/shaders/light.frag.glsl");
+        "data/shaders/light.frag.glsl",
+        { "IS_SPOT_LIGHT" });
     g_QuadProgram = graphicsDevice->CreateProgramFromFiles(
         "PP_FSQ",
         "data/shaders/quad.vert.glsl",
@@ -594,21 +1345,82 @@ int main(int /*argc*/, char** /*argv*/)
         "PP_Emission",
         "data/shaders/emission.vert.glsl",
         "data/shaders/emission.frag.glsl");
+    g_InstanceCullProgram = graphicsDevice->CreateComputeProgramFromFile(
+        "PP_InstanceCull",
+        "data/shaders/instancecull.comp.glsl");
+    g_HierarchicalZBufferProgram = graphicsDevice->CreateComputeProgramFromFile(
+        "PP_HierarchicalZBuffer",
+        "data/shaders/hzb.comp.glsl");
+
+    g_UpscaleProgram = graphicsDevice->CreateProgramFromFiles(
+        "PP_Upscale",
+        "data/shaders/upscale.vert.glsl",
+        "data/shaders/upscale.frag.glsl");
+    g_PostProgram = graphicsDevice->CreateComputeProgramFromFile(
+        "PP_Post",
+        "data/shaders/post.comp.glsl");
+
+    // variants that are only selected later, compiling them now keeps their objects from popping in
+    g_GeometryProgram->Prepare(kGeometryPermutationInstanced);
+    g_GeometryProgram->Prepare(kGeometryPermutationInstanced | kGeometryPermutationExcludeFromMotionBlur);
+    g_LightProgram->Prepare(kLightPermutationSpotLight);
+
+    g_HierarchicalZBuffer = new HierarchicalZBuffer(*g_HierarchicalZBufferProgram, g_RenderTargetManager->TargetSize().x, g_RenderTargetManager->TargetSize().y);
+    g_MotionBlurTiles = new MotionBlurTiles(*g_MotionBlurTileMaxProgram, *g_MotionBlurNeighborMaxProgram, g_RenderTargetManager->TargetSize().x, g_RenderTargetManager->TargetSize().y);
+
+    // a benchmark runs what it started with
+    if (g_IsHotReloadEnabled && !g_IsBenchmarkEnabled)
+    {
+        g_FileWatcher = new FileWatcher("data", std::chrono::milliseconds(500));
+        g_FileWatcher->Start();
+    }
+
+    g_DynamicResolution = new DynamicResolution(g_TargetFrameMilliseconds);
+    // a benchmark compares builds at one fixed resolution
+    g_DynamicResolution->SetEnabled(g_IsDynamicResolutionEnabled && !g_IsBenchmarkEnabled);
+
+    glCreateSamplers(1, &g_LinearSampler);
+    glSamplerParameteri(g_LinearSampler, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glSamplerParameteri(g_LinearSampler, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glSamplerParameteri(g_LinearSampler, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glSamplerParameteri(g_LinearSampler, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+    // starting room for the frame uniforms, the batched instance matrices and the visible lights of one
+    // frame, the ring grows on its own once a frame needs more
+    auto constexpr frameDataRegionSize = 4u * 1024u * 1024u;
+    g_FramesInFlight = new FramesInFlight(g_FramesInFlightDepth);
+    // results are read one frame after the slot's fence signalled, they are always available by then
+    g_GpuProfiler = new GpuProfiler(g_FramesInFlight->Depth() + 1, g_IsBenchmarkEnabled ? g_BenchmarkSettings.FrameCount : 240);
+    g_FrameDataRing = new FrameDataRing(frameDataRegionSize, g_FramesInFlight->Depth());
 
     /* uniforms */
-    constexpr auto kUniformProjectionMatrix = 0;
-    constexpr auto kUniformViewMatrix = 1;
+    constexpr auto kUniformBlockFrameData = 0;
     constexpr auto kUniformMotionBlurVelocityScale = 0;
+    constexpr auto kUniformMotionBlurResolutionScale = 1;
+    constexpr auto kUniformMotionBlurMaxVelocity = 2;
     constexpr auto kUniformMotionBlurUvDiff = 3;
+    constexpr auto kUniformMotionBlurUpsampleUvDiff = 3;
+    constexpr auto motionBlurVelocityScale = 2.0f;
+    constexpr auto kUniformTransitionUvDiff = 3;
+    constexpr auto kUniformUpscaleSharpness = 0;
+    constexpr auto kUniformUpscaleUvDiff = 3;
 
     constexpr auto fieldOfView = glm::radians(60.0f);
-    auto const cameraProjectionMatrix = glm::perspective(fieldOfView, static_cast<f32>(windowWidth) / static_cast<f32>(windowHeight), 0.1f, 1000.0f);
-    
-    g_GeometryProgram->SetVertexShaderUniform(kUniformProjectionMatrix, cameraProjectionMatrix);
+    auto cameraProjectionMatrix = glm::perspective(fieldOfView, static_cast<f32>(frameWidth) / static_cast<f32>(frameHeight), 0.1f, 1000.0f);
+    auto viewProjectionPrevious = cameraProjectionMatrix * g_Camera_View;
 
     // SCENE SETUP BEGIN ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
     g_Scene_Current->Initialize();
+    g_PhysicsScene->AddAsteroids(static_cast<SpaceScene*>(g_Scene_Current)->GetAsteroidInstances());
+
+    // bounding sphere radius of the unit cube
+    auto constexpr asteroidBoundingRadius = 0.8660254f;
+    g_AsteroidCuller = new InstanceCuller(
+        *g_InstanceCullProgram,
+        *static_cast<SpaceScene*>(g_Scene_Current)->GetAsteroidInstanceBuffer(),
+        g_CubeGeometry->IndexCount(),
+        asteroidBoundingRadius);
 
     // SCENE SETUP END //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
     
@@ -619,20 +1431,29 @@ int main(int /*argc*/, char** /*argv*/)
 
     auto framesToAverage = 100;
     auto frameCounter = 0;
+    auto physicsDroppedSeconds = 0.0f;
 
     auto visibleLights = 0;
 
-    glfwSwapInterval(g_IsVsyncEnabled ? 1 : 0);
+    glfwSwapInterval(g_IsVsyncEnabled && !g_IsBenchmarkEnabled ? 1 : 0);
 
-    g_MousePosXOld = windowWidth / 2;
-    g_MousePosYOld = windowHeight / 2;
-    glfwSetCursorPos(g_Window, g_MousePosXOld, g_MousePosYOld);
-    glfwSetInputMode(g_Window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+    const auto benchmarkCameraPath = CameraPath::CreateDefault();
+    BenchmarkRecorder benchmarkRecorder(g_BenchmarkSettings);
+    u32 benchmarkFrame = 0;
+
+    if (!g_IsBenchmarkEnabled)
+    {
+        g_MousePosXOld = windowWidth / 2;
+        g_MousePosYOld = windowHeight / 2;
+        glfwSetCursorPos(g_Window, g_MousePosXOld, g_MousePosYOld);
+        glfwSetInputMode(g_Window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+    }
 
     glViewport(0, 0, frameWidth, frameHeight);
     
     while (!glfwWindowShouldClose(g_Window))
     {
+        PROFILE_SCOPE("Frame");
         const auto t2 = glfwGetTime();
         const auto deltaTime = static_cast<f32>(t2 - t1);
         t1 = t2;
@@ -648,11 +1469,20 @@ int main(int /*argc*/, char** /*argv*/)
             const auto deltaTimeStandardError = sqrt(deltaTimeAverageSquared - deltaTimeAverage * deltaTimeAverage) /
                 sqrt(framesToAverage);
 
-            char str[128];
-            snprintf(str, sizeof(str), "emptyspace, frame = %.3fms +/- %.4fms, fps = %.1f, %d frames, %d visible lights, %.3f", deltaTimeAverage * 1000.0f,
-                1000.0f * deltaTimeStandardError, 1.0f / deltaTimeAverage, framesToAverage, visibleLights, g_Transition_Factor.r);
+            const auto& renderQueueStatistics = g_GeometryRenderQueue.Statistics();
+            const auto stateChangesAvoided = renderQueueStatistics.ProgramChangesAvoided + renderQueueStatistics.MaterialChangesAvoided + renderQueueStatistics.GeometryChangesAvoided;
+
+            char str[192];
+            snprintf(str, sizeof(str), "emptyspace, frame = %.3fms +/- %.4fms, fps = %.1f, %d frames, %d visible lights, %u draws, %u objects, %u state changes avoided, %.3f", deltaTimeAverage * 1000.0f,
+                1000.0f * deltaTimeStandardError, 1.0f / deltaTimeAverage, framesToAverage, visibleLights, renderQueueStatistics.DrawCount, renderQueueStatistics.InstanceCount, stateChangesAvoided, g_Transition_Factor.r);
             glfwSetWindowTitle(g_Window, str);
 
+            if (g_PhysicsScene->DroppedSeconds() > physicsDroppedSeconds)
+            {
+                std::clog << "PHYSX: Simulation fell behind, dropped " << g_PhysicsScene->DroppedSeconds() - physicsDroppedSeconds << "s of frame time\n";
+                physicsDroppedSeconds = g_PhysicsScene->DroppedSeconds();
+            }
+
             framesToAverage = static_cast<int>(1.0f / deltaTimeAverage);
 
             deltaTimeAverage = 0.0f;
@@ -660,51 +1490,131 @@ int main(int /*argc*/, char** /*argv*/)
             frameCounter = 0;
         }
 
-        Update(deltaTime);
+        if (g_IsBenchmarkEnabled)
+        {
+            if (benchmarkFrame >= g_BenchmarkSettings.WarmupFrameCount)
+            {
+                benchmarkRecorder.AddFrame(deltaTime * 1000.0f);
+            }
+            if (++benchmarkFrame > g_BenchmarkSettings.WarmupFrameCount + g_BenchmarkSettings.FrameCount)
+            {
+                glfwSetWindowShouldClose(g_Window, true);
+                continue;
+            }
+        }
+
+        Update(g_IsBenchmarkEnabled ? g_BenchmarkSettings.DeltaTime : deltaTime);
 
-        auto const camera = Camera::FromPhysicsScene(*g_PhysicsScene);
+        auto camera = Camera::FromPhysicsScene(*g_PhysicsScene);
+        if (g_IsBenchmarkEnabled)
+        {
+            const auto totalFrameCount = g_BenchmarkSettings.WarmupFrameCount + g_BenchmarkSettings.FrameCount;
+            const auto pose = benchmarkCameraPath.Evaluate(static_cast<f32>(benchmarkFrame) / static_cast<f32>(totalFrameCount));
+            camera.Position = pose.Position;
+            camera.Direction = pose.Direction;
+            g_Camera_View = glm::lookAt(pose.Position, pose.Position + pose.Direction, glm::vec3(0.0f, 1.0f, 0.0f));
+        }
+
+        if (g_FileWatcher != nullptr)
+        {
+            ReloadChangedAssets();
+        }
+
+        if (g_RenderTargetManager->Update(glfwGetTime()))
+        {
+            frameWidth = g_RenderTargetManager->Size().x;
+            frameHeight = g_RenderTargetManager->Size().y;
+            cameraProjectionMatrix = glm::perspective(fieldOfView, static_cast<f32>(frameWidth) / static_cast<f32>(frameHeight), 0.1f, 1000.0f);
+
+            // the pyramid follows the target size, its readback refers to the old targets
+            const auto targetSize = g_RenderTargetManager->TargetSize();
+            delete g_HierarchicalZBuffer;
+            g_HierarchicalZBuffer = new HierarchicalZBuffer(*g_HierarchicalZBufferProgram, targetSize.x, targetSize.y);
+            delete g_MotionBlurTiles;
+            g_MotionBlurTiles = new MotionBlurTiles(*g_MotionBlurTileMaxProgram, *g_MotionBlurNeighborMaxProgram, targetSize.x, targetSize.y);
+        }
+
+        g_Frustum.CalculateFrustum(cameraProjectionMatrix, g_Camera_View);
+        const auto viewProjection = cameraProjectionMatrix * g_Camera_View;
 
         ///////////////////////// SCENE UPDATE BEGIN /////////////////////////
 
-        g_Scene_Current->Update(deltaTime, camera);
+        // the workers update and cull the scene while this thread waits for a free frame slot and
+        // records the gpu work that does not depend on them
+        g_HierarchicalZBuffer->UpdateReadback();
+        StartSceneJobs(deltaTime, camera, viewProjection);
 
         ///////////////////////// SCENE UPDATE END /////////////////////////
 
-        g_Frustum.CalculateFrustum(cameraProjectionMatrix, g_Camera_View);
-        g_GeometryProgram->SetVertexShaderUniform(kUniformViewMatrix, g_Camera_View);
+        g_FrameDataRing->BeginFrame(g_FramesInFlight->BeginFrame());
+        g_GpuProfiler->BeginFrame();
+        const FrameUniforms frameUniforms
+        {
+            cameraProjectionMatrix,
+            g_Camera_View,
+            viewProjection,
+            viewProjectionPrevious,
+            glm::vec4(camera.Position, 1.0f)
+        };
+        g_FrameDataRing->BindAsUniformBuffer(kUniformBlockFrameData, g_FrameDataRing->Write(frameUniforms));
+        viewProjectionPrevious = viewProjection;
+
+        g_DynamicResolution->Update(g_GpuProfiler->LatestMilliseconds("Frame"));
+        const auto renderSize = g_DynamicResolution->RenderSize(glm::ivec2(frameWidth, frameHeight));
+        const auto uvScale = g_DynamicResolution->UvScale(glm::ivec2(frameWidth, frameHeight), g_RenderTargetManager->TargetSize());
 
+        g_GpuProfiler->PushScope(9, "Frame");
+
+        CullInstances(camera.Position);
         RenderGBuffer(
-            frameWidth,
-            frameHeight,
+            renderSize.x,
+            renderSize.y,
             cameraProjectionMatrix,
             g_Camera_View);
+        BuildHierarchicalZBuffer(renderSize, viewProjection);
         RenderLights(
             *g_gBufferPositionTexture,
             *g_gBufferNormalTexture,
             *g_gBufferDepthTexture,
-            cameraProjectionMatrix,
-            camera.Position,
             camera.Direction,
             visibleLights);
-        RenderEmission(
-            *g_LightBufferTexture,
-            *g_EmissionTexture);
-        ResolveGBuffer(
-            *g_SkyboxTextureCube,
-            *g_gBufferPositionTexture,
-            *g_gBufferNormalTexture,
-            *g_gBufferAlbedoTexture,
-            *g_gBufferDepthTexture,
-            *g_LightBufferTexture,
-            *g_EmissionTexture,
-            frameWidth,
-            frameHeight,
-            fieldOfView);
+        // the image motion blur and the final output start from
+        const Texture* compositeTexture = g_gBufferFinalTexture;
+        if (g_IsFusedPostEnabled)
+        {
+            ResolveGBufferFused(
+                *g_SkyboxTextureCube,
+                *g_gBufferAlbedoTexture,
+                *g_gBufferDepthTexture,
+                *g_LightBufferTexture,
+                frameWidth,
+                frameHeight,
+                fieldOfView,
+                renderSize,
+                g_Transition_Factor);
+        }
+        else
+        {
+            RenderEmission(
+                *g_LightBufferTexture,
+                *g_EmissionTexture);
+            ResolveGBuffer(
+                *g_SkyboxTextureCube,
+                *g_gBufferPositionTexture,
+                *g_gBufferNormalTexture,
+                *g_gBufferAlbedoTexture,
+                *g_gBufferDepthTexture,
+                *g_LightBufferTexture,
+                *g_EmissionTexture,
+                frameWidth,
+                frameHeight,
+                fieldOfView,
+                uvScale);
+        }
 
-        if (g_Transition_Factor.w > 0.0f)
+        if (!g_IsFusedPostEnabled && g_Transition_Factor.w > 0.0f && g_QuadProgram->IsReady())
         {
-            constexpr std::string_view transitionDebugGroup = "Transition";
-            glPushDebugGroup(GL_DEBUG_SOURCE_APPLICATION, 5, static_cast<GLsizei>(transitionDebugGroup.length()), transitionDebugGroup.data());
+            GpuProfileScope profileScope(*g_GpuProfiler, 5, "Transition");
 
             /* ============== TRANSITION EFFECT =================== */
             g_TransitionFramebuffer->Clear(0, glm::value_ptr(glm::vec3(0.0)));
@@ -714,6 +1624,7 @@ int main(int /*argc*/, char** /*argv*/)
 
             g_QuadProgram->Bind();
             g_QuadProgram->SetFragmentShaderUniform(0, g_Transition_Factor);
+            g_QuadProgram->SetVertexShaderUniform(kUniformTransitionUvDiff, uvScale);
 
             glDisable(GL_DEPTH_TEST);
             glDisable(GL_CULL_FACE);
@@ -724,50 +1635,125 @@ int main(int /*argc*/, char** /*argv*/)
             glEnable(GL_DEPTH_TEST);
             glEnable(GL_CULL_FACE);
             glDisable(GL_BLEND);
+
+            compositeTexture = g_TransitionTexture;
         }
         /* ============== TRANSITION EFFECT =================== */
 
-        if (g_IsMotionBlurEnabled)
+        // motion blur stays off until all of its programs have compiled
+        const auto isMotionBlurActive = g_IsMotionBlurEnabled &&
+            g_MotionBlurTileMaxProgram->IsReady() &&
+            g_MotionBlurNeighborMaxProgram->IsReady() &&
+            g_MotionBlurProgram->IsReady() &&
+            (!g_IsMotionBlurHalfResolution || g_MotionBlurUpsampleProgram->IsReady());
+        if (isMotionBlurActive)
         {
-            constexpr std::string_view motionBlurDebugGroup = "MotionBlur";
-            glPushDebugGroup(GL_DEBUG_SOURCE_APPLICATION, 6, static_cast<GLsizei>(motionBlurDebugGroup.length()), motionBlurDebugGroup.data());
+            GpuProfileScope profileScope(*g_GpuProfiler, 6, "MotionBlur");
             /* motion blur ========================================================================= begin */
-            g_MotionBlurFramebuffer->Clear(0, glm::value_ptr(glm::vec3(0.0f)));
-            g_MotionBlurFramebuffer->Bind();
+            g_MotionBlurTiles->Build(*g_gBufferVelocityTexture, renderSize, motionBlurVelocityScale);
 
-            if (g_Transition_Factor.w > 0.0f)
-            {
-                g_TransitionTexture->Bind(0);
-            }
-            else
+            const auto& sourceTexture = *compositeTexture;
+
+            auto& reconstructFramebuffer = g_IsMotionBlurHalfResolution
+                ? *g_MotionBlurHalfFramebuffer
+                : *g_MotionBlurFramebuffer;
+            reconstructFramebuffer.Clear(0, glm::value_ptr(glm::vec3(0.0f)));
+            reconstructFramebuffer.Bind();
+            if (g_IsMotionBlurHalfResolution)
             {
-                g_gBufferFinalTexture->Bind(0);
+                glViewport(0, 0, (renderSize.x + 1) / 2, (renderSize.y + 1) / 2);
             }
+
+            sourceTexture.Bind(0);
             g_gBufferVelocityTexture->Bind(1);
+            g_gBufferDepthTexture->Bind(2);
+            g_MotionBlurTiles->BindNeighborMax(3);
 
             g_EmptyGeometry->Bind();
             g_MotionBlurProgram->Bind();
-            g_MotionBlurProgram->SetVertexShaderUniform(kUniformMotionBlurUvDiff, glm::vec2(1.0f, 1.0f));
-            g_MotionBlurProgram->SetFragmentShaderUniform(kUniformMotionBlurVelocityScale, 2.0f);
+            g_MotionBlurProgram->SetVertexShaderUniform(kUniformMotionBlurUvDiff, uvScale);
+            g_MotionBlurProgram->SetFragmentShaderUniform(kUniformMotionBlurUvDiff, uvScale);
+            g_MotionBlurProgram->SetFragmentShaderUniform(kUniformMotionBlurVelocityScale, motionBlurVelocityScale);
+            g_MotionBlurProgram->SetFragmentShaderUniform(kUniformMotionBlurResolutionScale, g_IsMotionBlurHalfResolution ? 2 : 1);
+            g_MotionBlurProgram->SetFragmentShaderUniform(kUniformMotionBlurMaxVelocity, MotionBlurTiles::MaxVelocity);
 
             glCullFace(GL_FRONT);
             glDrawArraysInstancedBaseInstance(GL_TRIANGLES, 0, 3, 1, 0);
+
+            if (g_IsMotionBlurHalfResolution)
+            {
+                glViewport(0, 0, renderSize.x, renderSize.y);
+
+                g_MotionBlurFramebuffer->Bind();
+                sourceTexture.Bind(0);
+                g_MotionBlurHalfTexture->Bind(1);
+                g_gBufferDepthTexture->Bind(2);
+                g_MotionBlurTiles->BindNeighborMax(3);
+
+                g_MotionBlurUpsampleProgram->Bind();
+                g_MotionBlurUpsampleProgram->SetVertexShaderUniform(kUniformMotionBlurUpsampleUvDiff, uvScale);
+                g_MotionBlurUpsampleProgram->SetFragmentShaderUniform(kUniformMotionBlurUpsampleUvDiff, uvScale);
+
+                glDrawArraysInstancedBaseInstance(GL_TRIANGLES, 0, 3, 1, 0);
+            }
             glCullFace(GL_BACK);
-            glPopDebugGroup();
             /* motion blur =========================================================================== end */
         }
 
         /* final output */
-        glBindFramebuffer(GL_FRAMEBUFFER, 0);
-        glViewport(0, 0, windowWidth, windowHeight);
-        glBlitNamedFramebuffer(g_IsMotionBlurEnabled
-            ? g_MotionBlurFramebuffer->Id()
-            : g_IsTransitionEffectEnabled
-                ? g_TransitionFramebuffer->Id()
-                : g_FinalFramebuffer->Id(), 0, 0, 0, frameWidth, frameHeight, 0, 0, windowWidth, windowHeight, GL_COLOR_BUFFER_BIT, GL_NEAREST);
-
-        glFinish();
-        glfwSwapBuffers(g_Window);
+        if (g_UpscaleProgram->IsReady())
+        {
+            GpuProfileScope profileScope(*g_GpuProfiler, 10, "Upscale");
+
+            glBindFramebuffer(GL_FRAMEBUFFER, 0);
+            glViewport(0, 0, frameWidth, frameHeight);
+
+            const auto& outputTexture = isMotionBlurActive
+                ? *g_MotionBlurTexture
+                : *compositeTexture;
+            outputTexture.Bind(0);
+            glBindSampler(0, g_LinearSampler);
+
+            // sharpen only what was actually upscaled
+            const auto sharpness = renderSize.x < frameWidth ? 0.5f : 0.0f;
+
+            g_EmptyGeometry->Bind();
+            g_UpscaleProgram->Bind();
+            g_UpscaleProgram->SetVertexShaderUniform(kUniformUpscaleUvDiff, uvScale);
+            g_UpscaleProgram->SetFragmentShaderUniform(kUniformUpscaleUvDiff, uvScale);
+            g_UpscaleProgram->SetFragmentShaderUniform(kUniformUpscaleSharpness, sharpness);
+
+            glDisable(GL_DEPTH_TEST);
+            glCullFace(GL_FRONT);
+            glDrawArraysInstancedBaseInstance(GL_TRIANGLES, 0, 3, 1, 0);
+            glCullFace(GL_BACK);
+            glEnable(GL_DEPTH_TEST);
+
+            glBindSampler(0, 0);
+        }
+
+        g_GpuProfiler->PopScope();
+
+        g_GpuProfiler->EndFrame();
+        g_FramesInFlight->EndFrame();
+        {
+            PROFILE_SCOPE("SwapBuffers");
+            glfwSwapBuffers(g_Window);
+        }
+    }
+
+    if (g_IsBenchmarkEnabled)
+    {
+        benchmarkRecorder.WriteReport(
+            reinterpret_cast<const char*>(glGetString(GL_RENDERER)),
+            reinterpret_cast<const char*>(glGetString(GL_VERSION)),
+            g_FramesInFlight->Depth(),
+            g_GpuProfiler->Statistics());
+    }
+
+    if (!g_CpuTraceFilePath.empty())
+    {
+        CpuProfiler::WriteChromeTrace(g_CpuTraceFilePath);
     }
 
     Cleanup();
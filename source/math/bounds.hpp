@@ -0,0 +1,101 @@
+#pragma once
+
+#include "types.hpp"
+
+#include <glm/glm.hpp>
+
+#include <vector>
+
+struct BoundingBox
+{
+	glm::vec3 Min{ 0.0f };
+	glm::vec3 Max{ 0.0f };
+
+	[[nodiscard]] glm::vec3 Center() const
+	{
+		return 0.5f * (Min + Max);
+	}
+
+	[[nodiscard]] glm::vec3 Extent() const
+	{
+		return 0.5f * (Max - Min);
+	}
+
+	// world space box enclosing the transformed box (Arvo, Graphics Gems 1990)
+	[[nodiscard]] BoundingBox Transform(const glm::mat4& transform) const
+	{
+		const auto center = glm::vec3(transform * glm::vec4(Center(), 1.0f));
+		const auto extent = Extent();
+		const auto transformedExtent = glm::vec3(
+			glm::abs(transform[0][0]) * extent.x + glm::abs(transform[1][0]) * extent.y + glm::abs(transform[2][0]) * extent.z,
+			glm::abs(transform[0][1]) * extent.x + glm::abs(transform[1][1]) * extent.y + glm::abs(transform[2][1]) * extent.z,
+			glm::abs(transform[0][2]) * extent.x + glm::abs(transform[1][2]) * extent.y + glm::abs(transform[2][2]) * extent.z);
+
+		return BoundingBox{ center - transformedExtent, center + transformedExtent };
+	}
+};
+
+// structure of arrays layouts consumed by the batch culling functions of Frustum
+struct SphereBoundsList
+{
+	std::vector<f32> CenterX;
+	std::vector<f32> CenterY;
+	std::vector<f32> CenterZ;
+	std::vector<f32> Radius;
+
+	void Clear()
+	{
+		CenterX.clear();
+		CenterY.clear();
+		CenterZ.clear();
+		Radius.clear();
+	}
+
+	void Add(const glm::vec3& center, const f32 radius)
+	{
+		CenterX.push_back(center.x);
+		CenterY.push_back(center.y);
+		CenterZ.push_back(center.z);
+		Radius.push_back(radius);
+	}
+
+	[[nodiscard]] u32 Size() const
+	{
+		return static_cast<u32>(Radius.size());
+	}
+};
+
+struct BoxBoundsList
+{
+	std::vector<f32> MinX;
+	std::vector<f32> MinY;
+	std::vector<f32> MinZ;
+	std::vector<f32> MaxX;
+	std::vector<f32> MaxY;
+	std::vector<f32> MaxZ;
+
+	void Clear()
+	{
+		MinX.clear();
+		MinY.clear();
+		MinZ.clear();
+		MaxX.clear();
+		MaxY.clear();
+		MaxZ.clear();
+	}
+
+	void Add(const BoundingBox& box)
+	{
+		MinX.push_back(box.Min.x);
+		MinY.push_back(box.Min.y);
+		MinZ.push_back(box.Min.z);
+		MaxX.push_back(box.Max.x);
+		MaxY.push_back(box.Max.y);
+		MaxZ.push_back(box.Max.z);
+	}
+
+	[[nodiscard]] u32 Size() const
+	{
+		return static_cast<u32>(MinX.size());
+	}
+};
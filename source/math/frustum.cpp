@@ -0,0 +1,311 @@
+#include "math/frustum.hpp"
+#include "threading/threadpool.hpp"
+
+#include <cstring>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define FRUSTUM_CULL_AVX2
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define FRUSTUM_CULL_SSE2
+#endif
+
+// chunk size used when culling in parallel, small enough to balance, large enough to amortize scheduling
+constexpr u32 kCullChunkSize = 4096;
+
+// appends the indices of all lanes set in the visibility mask without branching per lane
+inline u32 AppendVisible(const s32 visibleMask, const u32 laneCount, const u32 firstIndex, u32* visibleIndices, u32 visibleCount)
+{
+	for (u32 lane = 0; lane < laneCount; lane++)
+	{
+		visibleIndices[visibleCount] = firstIndex + lane;
+		visibleCount += static_cast<u32>(visibleMask >> lane) & 1u;
+	}
+
+	return visibleCount;
+}
+
+// moves the per chunk results, which are stored at the start of each chunk, next to each other
+inline u32 CompactChunks(std::vector<u32>& visibleIndices, const std::vector<u32>& chunkVisibleCounts)
+{
+	u32 visibleCount = 0;
+	for (std::size_t chunk = 0; chunk < chunkVisibleCounts.size(); chunk++)
+	{
+		const auto chunkBegin = visibleIndices.data() + chunk * kCullChunkSize;
+		if (visibleIndices.data() + visibleCount != chunkBegin)
+		{
+			std::memmove(visibleIndices.data() + visibleCount, chunkBegin, chunkVisibleCounts[chunk] * sizeof(u32));
+		}
+		visibleCount += chunkVisibleCounts[chunk];
+	}
+
+	visibleIndices.resize(visibleCount);
+	return visibleCount;
+}
+
+u32 Frustum::CullSpheres(
+	const f32* centerX,
+	const f32* centerY,
+	const f32* centerZ,
+	const f32* radius,
+	const u32 count,
+	u32* visibleIndices) const
+{
+	return CullSpheresRange(centerX, centerY, centerZ, radius, count, 0, visibleIndices);
+}
+
+u32 Frustum::CullBoxes(
+	const f32* minX,
+	const f32* minY,
+	const f32* minZ,
+	const f32* maxX,
+	const f32* maxY,
+	const f32* maxZ,
+	const u32 count,
+	u32* visibleIndices) const
+{
+	return CullBoxesRange(minX, minY, minZ, maxX, maxY, maxZ, count, 0, visibleIndices);
+}
+
+u32 Frustum::CullSpheres(ThreadPool& threadPool, const SphereBoundsList& spheres, std::vector<u32>& visibleIndices) const
+{
+	const auto count = spheres.Size();
+	visibleIndices.resize(count);
+	std::vector<u32> chunkVisibleCounts((count + kCullChunkSize - 1) / kCullChunkSize);
+
+	threadPool.ParallelFor(count, kCullChunkSize, [&](const u32 begin, const u32 end)
+	{
+		chunkVisibleCounts[begin / kCullChunkSize] = CullSpheresRange(
+			spheres.CenterX.data() + begin,
+			spheres.CenterY.data() + begin,
+			spheres.CenterZ.data() + begin,
+			spheres.Radius.data() + begin,
+			end - begin,
+			begin,
+			visibleIndices.data() + begin);
+	});
+
+	return CompactChunks(visibleIndices, chunkVisibleCounts);
+}
+
+u32 Frustum::CullBoxes(ThreadPool& threadPool, const BoxBoundsList& boxes, std::vector<u32>& visibleIndices) const
+{
+	const auto count = boxes.Size();
+	visibleIndices.resize(count);
+	std::vector<u32> chunkVisibleCounts((count + kCullChunkSize - 1) / kCullChunkSize);
+
+	threadPool.ParallelFor(count, kCullChunkSize, [&](const u32 begin, const u32 end)
+	{
+		chunkVisibleCounts[begin / kCullChunkSize] = CullBoxesRange(
+			boxes.MinX.data() + begin,
+			boxes.MinY.data() + begin,
+			boxes.MinZ.data() + begin,
+			boxes.MaxX.data() + begin,
+			boxes.MaxY.data() + begin,
+			boxes.MaxZ.data() + begin,
+			end - begin,
+			begin,
+			visibleIndices.data() + begin);
+	});
+
+	return CompactChunks(visibleIndices, chunkVisibleCounts);
+}
+
+u32 Frustum::CullSpheresRange(
+	const f32* centerX,
+	const f32* centerY,
+	const f32* centerZ,
+	const f32* radius,
+	const u32 count,
+	const u32 firstIndex,
+	u32* visibleIndices) const
+{
+	u32 visibleCount = 0;
+	u32 i = 0;
+
+#if defined(FRUSTUM_CULL_AVX2)
+	__m256 planeA[6];
+	__m256 planeB[6];
+	__m256 planeC[6];
+	__m256 planeD[6];
+	for (auto side = 0; side < 6; side++)
+	{
+		planeA[side] = _mm256_set1_ps(_frustum[side][A]);
+		planeB[side] = _mm256_set1_ps(_frustum[side][B]);
+		planeC[side] = _mm256_set1_ps(_frustum[side][C]);
+		planeD[side] = _mm256_set1_ps(_frustum[side][D]);
+	}
+
+	for (; i + 8 <= count; i += 8)
+	{
+		const auto x = _mm256_loadu_ps(centerX + i);
+		const auto y = _mm256_loadu_ps(centerY + i);
+		const auto z = _mm256_loadu_ps(centerZ + i);
+		const auto negativeRadius = _mm256_sub_ps(_mm256_setzero_ps(), _mm256_loadu_ps(radius + i));
+
+		auto inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+		for (auto side = 0; side < 6; side++)
+		{
+			const auto distance = _mm256_add_ps(
+				_mm256_add_ps(_mm256_mul_ps(planeA[side], x), _mm256_mul_ps(planeB[side], y)),
+				_mm256_add_ps(_mm256_mul_ps(planeC[side], z), planeD[side]));
+			inside = _mm256_and_ps(inside, _mm256_cmp_ps(distance, negativeRadius, _CMP_GT_OQ));
+		}
+
+		visibleCount = AppendVisible(_mm256_movemask_ps(inside), 8, firstIndex + i, visibleIndices, visibleCount);
+	}
+#elif defined(FRUSTUM_CULL_SSE2)
+	__m128 planeA[6];
+	__m128 planeB[6];
+	__m128 planeC[6];
+	__m128 planeD[6];
+	for (auto side = 0; side < 6; side++)
+	{
+		planeA[side] = _mm_set1_ps(_frustum[side][A]);
+		planeB[side] = _mm_set1_ps(_frustum[side][B]);
+		planeC[side] = _mm_set1_ps(_frustum[side][C]);
+		planeD[side] = _mm_set1_ps(_frustum[side][D]);
+	}
+
+	for (; i + 4 <= count; i += 4)
+	{
+		const auto x = _mm_loadu_ps(centerX + i);
+		const auto y = _mm_loadu_ps(centerY + i);
+		const auto z = _mm_loadu_ps(centerZ + i);
+		const auto negativeRadius = _mm_sub_ps(_mm_setzero_ps(), _mm_loadu_ps(radius + i));
+
+		auto inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+		for (auto side = 0; side < 6; side++)
+		{
+			const auto distance = _mm_add_ps(
+				_mm_add_ps(_mm_mul_ps(planeA[side], x), _mm_mul_ps(planeB[side], y)),
+				_mm_add_ps(_mm_mul_ps(planeC[side], z), planeD[side]));
+			inside = _mm_and_ps(inside, _mm_cmpgt_ps(distance, negativeRadius));
+		}
+
+		visibleCount = AppendVisible(_mm_movemask_ps(inside), 4, firstIndex + i, visibleIndices, visibleCount);
+	}
+#endif
+
+	for (; i < count; i++)
+	{
+		auto inside = true;
+		for (auto side = 0; side < 6; side++)
+		{
+			const auto distance = _frustum[side][A] * centerX[i] + _frustum[side][B] * centerY[i] + _frustum[side][C] * centerZ[i] + _frustum[side][D];
+			inside &= distance > -radius[i];
+		}
+
+		visibleIndices[visibleCount] = firstIndex + i;
+		visibleCount += inside ? 1 : 0;
+	}
+
+	return visibleCount;
+}
+
+u32 Frustum::CullBoxesRange(
+	const f32* minX,
+	const f32* minY,
+	const f32* minZ,
+	const f32* maxX,
+	const f32* maxY,
+	const f32* maxZ,
+	const u32 count,
+	const u32 firstIndex,
+	u32* visibleIndices) const
+{
+	// a box is outside as soon as its corner furthest along a plane normal is behind that plane,
+	// which corner that is only depends on the signs of the plane normal
+	s32 useMaxX[6];
+	s32 useMaxY[6];
+	s32 useMaxZ[6];
+	for (auto side = 0; side < 6; side++)
+	{
+		useMaxX[side] = _frustum[side][A] >= 0.0f ? 1 : 0;
+		useMaxY[side] = _frustum[side][B] >= 0.0f ? 1 : 0;
+		useMaxZ[side] = _frustum[side][C] >= 0.0f ? 1 : 0;
+	}
+
+	u32 visibleCount = 0;
+	u32 i = 0;
+
+#if defined(FRUSTUM_CULL_AVX2)
+	__m256 planeA[6];
+	__m256 planeB[6];
+	__m256 planeC[6];
+	__m256 planeD[6];
+	for (auto side = 0; side < 6; side++)
+	{
+		planeA[side] = _mm256_set1_ps(_frustum[side][A]);
+		planeB[side] = _mm256_set1_ps(_frustum[side][B]);
+		planeC[side] = _mm256_set1_ps(_frustum[side][C]);
+		planeD[side] = _mm256_set1_ps(_frustum[side][D]);
+	}
+
+	for (; i + 8 <= count; i += 8)
+	{
+		const __m256 x[2] = { _mm256_loadu_ps(minX + i), _mm256_loadu_ps(maxX + i) };
+		const __m256 y[2] = { _mm256_loadu_ps(minY + i), _mm256_loadu_ps(maxY + i) };
+		const __m256 z[2] = { _mm256_loadu_ps(minZ + i), _mm256_loadu_ps(maxZ + i) };
+
+		auto inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+		for (auto side = 0; side < 6; side++)
+		{
+			const auto distance = _mm256_add_ps(
+				_mm256_add_ps(_mm256_mul_ps(planeA[side], x[useMaxX[side]]), _mm256_mul_ps(planeB[side], y[useMaxY[side]])),
+				_mm256_add_ps(_mm256_mul_ps(planeC[side], z[useMaxZ[side]]), planeD[side]));
+			inside = _mm256_and_ps(inside, _mm256_cmp_ps(distance, _mm256_setzero_ps(), _CMP_GT_OQ));
+		}
+
+		visibleCount = AppendVisible(_mm256_movemask_ps(inside), 8, firstIndex + i, visibleIndices, visibleCount);
+	}
+#elif defined(FRUSTUM_CULL_SSE2)
+	__m128 planeA[6];
+	__m128 planeB[6];
+	__m128 planeC[6];
+	__m128 planeD[6];
+	for (auto side = 0; side < 6; side++)
+	{
+		planeA[side] = _mm_set1_ps(_frustum[side][A]);
+		planeB[side] = _mm_set1_ps(_frustum[side][B]);
+		planeC[side] = _mm_set1_ps(_frustum[side][C]);
+		planeD[side] = _mm_set1_ps(_frustum[side][D]);
+	}
+
+	for (; i + 4 <= count; i += 4)
+	{
+		const __m128 x[2] = { _mm_loadu_ps(minX + i), _mm_loadu_ps(maxX + i) };
+		const __m128 y[2] = { _mm_loadu_ps(minY + i), _mm_loadu_ps(maxY + i) };
+		const __m128 z[2] = { _mm_loadu_ps(minZ + i), _mm_loadu_ps(maxZ + i) };
+
+		auto inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+		for (auto side = 0; side < 6; side++)
+		{
+			const auto distance = _mm_add_ps(
+				_mm_add_ps(_mm_mul_ps(planeA[side], x[useMaxX[side]]), _mm_mul_ps(planeB[side], y[useMaxY[side]])),
+				_mm_add_ps(_mm_mul_ps(planeC[side], z[useMaxZ[side]]), planeD[side]));
+			inside = _mm_and_ps(inside, _mm_cmpgt_ps(distance, _mm_setzero_ps()));
+		}
+
+		visibleCount = AppendVisible(_mm_movemask_ps(inside), 4, firstIndex + i, visibleIndices, visibleCount);
+	}
+#endif
+
+	for (; i < count; i++)
+	{
+		auto inside = true;
+		for (auto side = 0; side < 6; side++)
+		{
+			const auto x = useMaxX[side] ? maxX[i] : minX[i];
+			const auto y = useMaxY[side] ? maxY[i] : minY[i];
+			const auto z = useMaxZ[side] ? maxZ[i] : minZ[i];
+			inside &= _frustum[side][A] * x + _frustum[side][B] * y + _frustum[side][C] * z + _frustum[side][D] > 0.0f;
+		}
+
+		visibleIndices[visibleCount] = firstIndex + i;
+		visibleCount += inside ? 1 : 0;
+	}
+
+	return visibleCount;
+}
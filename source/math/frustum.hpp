@@ -1,8 +1,15 @@
 #pragma once
 
+#include "types.hpp"
+#include "math/bounds.hpp"
+
 #include <glm/glm.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
+#include <vector>
+
+class ThreadPool;
+
 enum FrustumSide
 {
 	RIGHT = 0,		// The RIGHT side of the frustum
@@ -192,6 +199,56 @@ public:
 		return true;
 	}
 
+	[[nodiscard]] glm::vec4 Plane(const int side) const
+	{
+		return glm::vec4(_frustum[side][A], _frustum[side][B], _frustum[side][C], _frustum[side][D]);
+	}
+
+	// Batch culling of bounds in structure of arrays form. The indices of all visible entries are
+	// written to visibleIndices, which must have room for count entries, and their number is returned.
+	// Evaluates 8 (AVX2) or 4 (SSE2) entries per iteration, depending on what the build targets.
+	u32 CullSpheres(
+		const f32* centerX,
+		const f32* centerY,
+		const f32* centerZ,
+		const f32* radius,
+		const u32 count,
+		u32* visibleIndices) const;
+
+	u32 CullBoxes(
+		const f32* minX,
+		const f32* minY,
+		const f32* minZ,
+		const f32* maxX,
+		const f32* maxY,
+		const f32* maxZ,
+		const u32 count,
+		u32* visibleIndices) const;
+
+	// Same as above but split into chunks which are culled in parallel on the thread pool
+	u32 CullSpheres(ThreadPool& threadPool, const SphereBoundsList& spheres, std::vector<u32>& visibleIndices) const;
+	u32 CullBoxes(ThreadPool& threadPool, const BoxBoundsList& boxes, std::vector<u32>& visibleIndices) const;
+
 private:
+	u32 CullSpheresRange(
+		const f32* centerX,
+		const f32* centerY,
+		const f32* centerZ,
+		const f32* radius,
+		const u32 count,
+		const u32 firstIndex,
+		u32* visibleIndices) const;
+
+	u32 CullBoxesRange(
+		const f32* minX,
+		const f32* minY,
+		const f32* minZ,
+		const f32* maxX,
+		const f32* maxY,
+		const f32* maxZ,
+		const u32 count,
+		const u32 firstIndex,
+		u32* visibleIndices) const;
+
 	float _frustum[6][4];
 };
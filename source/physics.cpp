@@ -1,14 +1,122 @@
 #include "physics.hpp"
+#include "physicsdispatcher.hpp"
+#include "profiling/cpuprofiler.hpp"
 
 #include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
 
+#include <algorithm>
 #include <iostream>
+#include <map>
+#include <tuple>
 
 using namespace physx;
 
-PhysicsScene::PhysicsScene()
+namespace
 {
-	std::clog << "PHYSX: Initialising.\n";
+	constexpr f32 kAsteroidCellSize = 64.0f;
+	// PhysX limit for the actors in one aggregate
+	constexpr u32 kMaxActorsPerAggregate = 128;
+	constexpr u32 kBroadPhaseRegionSubdivisions = 4;
+	// enough work per job to pay for submitting it, few enough for hundreds of agents to spread over the workers
+	constexpr u32 kQueriesPerJob = 32;
+	// query filter word0 of the shapes, a batch only sees shapes sharing a bit with its own word0
+	constexpr PxU32 kQueryGroupAsteroid = 1u << 0;
+	constexpr PxU32 kQueryGroupShip = 1u << 1;
+
+	// the default shader plus swept contacts, they only happen for bodies with eENABLE_CCD set
+	PxFilterFlags ContactFilterShader(
+		PxFilterObjectAttributes attributes0,
+		PxFilterData filterData0,
+		PxFilterObjectAttributes attributes1,
+		PxFilterData filterData1,
+		PxPairFlags& pairFlags,
+		const void* constantBlock,
+		PxU32 constantBlockSize)
+	{
+		const auto filterFlags = PxDefaultSimulationFilterShader(attributes0, filterData0, attributes1, filterData1, pairFlags, constantBlock, constantBlockSize);
+		if (!PxFilterObjectIsTrigger(attributes0) && !PxFilterObjectIsTrigger(attributes1))
+		{
+			pairFlags |= PxPairFlag::eDETECT_CCD_CONTACT;
+		}
+		return filterFlags;
+	}
+
+	QueryHit ToQueryHit(const PxLocationHit& hit)
+	{
+		QueryHit queryHit;
+		queryHit.Actor = hit.actor;
+		queryHit.Position = hit.position;
+		queryHit.Normal = hit.normal;
+		queryHit.Distance = hit.distance;
+		queryHit.IsHit = true;
+		return queryHit;
+	}
+
+	PxFilterData QueryGroups(const PhysicsQueryBatch& batch)
+	{
+		return PxFilterData(kQueryGroupAsteroid | (batch.IncludesShip ? kQueryGroupShip : 0u), 0, 0, 0);
+	}
+
+	void RunRaycasts(const PxScene& scene, const RaycastQuery* queries, QueryHit* hits, const u32 count, const PxFilterData& queryGroups)
+	{
+		PROFILE_SCOPE("PhysicsScene::Raycasts");
+		const auto filterData = PxQueryFilterData(queryGroups, PxQueryFlag::eSTATIC | PxQueryFlag::eDYNAMIC);
+		for (u32 i = 0; i < count; i++)
+		{
+			PxRaycastBuffer buffer;
+			scene.raycast(queries[i].Origin, queries[i].Direction, queries[i].Distance, buffer, PxHitFlag::eDEFAULT, filterData);
+			hits[i] = buffer.hasBlock ? ToQueryHit(buffer.block) : QueryHit{};
+		}
+	}
+
+	void RunSweeps(const PxScene& scene, const SweepQuery* queries, QueryHit* hits, const u32 count, const PxFilterData& queryGroups)
+	{
+		PROFILE_SCOPE("PhysicsScene::Sweeps");
+		const auto filterData = PxQueryFilterData(queryGroups, PxQueryFlag::eSTATIC | PxQueryFlag::eDYNAMIC);
+		for (u32 i = 0; i < count; i++)
+		{
+			PxSweepBuffer buffer;
+			scene.sweep(PxSphereGeometry(queries[i].Radius), PxTransform(queries[i].Origin), queries[i].Direction, queries[i].Distance, buffer, PxHitFlag::eDEFAULT, filterData);
+			hits[i] = buffer.hasBlock ? ToQueryHit(buffer.block) : QueryHit{};
+		}
+	}
+
+	void RunOverlaps(const PxScene& scene, const OverlapQuery* queries, OverlapHit* hits, const u32 count, const PxFilterData& queryGroups)
+	{
+		PROFILE_SCOPE("PhysicsScene::Overlaps");
+		// every actor in the sphere is a touch, a blocking hit would end the query at the first one
+		const auto filterData = PxQueryFilterData(queryGroups, PxQueryFlag::eSTATIC | PxQueryFlag::eDYNAMIC | PxQueryFlag::eNO_BLOCK);
+		for (u32 i = 0; i < count; i++)
+		{
+			std::array<PxOverlapHit, OverlapHit::MaxActors> touches;
+			PxOverlapBuffer buffer(touches.data(), OverlapHit::MaxActors);
+			scene.overlap(PxSphereGeometry(queries[i].Radius), PxTransform(queries[i].Center), buffer, filterData);
+
+			hits[i].ActorCount = buffer.getNbTouches();
+			for (u32 j = 0; j < hits[i].ActorCount; j++)
+			{
+				hits[i].Actors[j] = touches[j].actor;
+			}
+		}
+	}
+
+	const char* BroadPhaseName(const PxBroadPhaseType::Enum broadPhaseType)
+	{
+		switch (broadPhaseType)
+		{
+			case PxBroadPhaseType::eSAP: return "SAP";
+			case PxBroadPhaseType::eMBP: return "MBP";
+			case PxBroadPhaseType::eABP: return "ABP";
+			default: return "GPU";
+		}
+	}
+}
+
+PhysicsScene::PhysicsScene(ThreadPool& threadPool, const PxBroadPhaseType::Enum broadPhaseType)
+	: _threadPool{ threadPool }
+{
+	std::clog << "PHYSX: Initialising, broadphase " << BroadPhaseName(broadPhaseType) << ".\n";
 
 	_foundation = PxCreateFoundation(PX_PHYSICS_VERSION, _allocator, _errorCallback);
 	_physics = PxCreatePhysics(PX_PHYSICS_VERSION, *_foundation, PxTolerancesScale(), true, nullptr);
@@ -16,11 +124,28 @@ PhysicsScene::PhysicsScene()
 	PxSceneDesc sceneDesc(_physics->getTolerancesScale());
 	sceneDesc.gravity = PxVec3(0.0f, 0.0f, 0.0f);
 
-	_dispatcher = PxDefaultCpuDispatcherCreate(2);
+	_dispatcher = new PhysicsDispatcher(threadPool);
 	sceneDesc.cpuDispatcher = _dispatcher;
-	sceneDesc.filterShader = PxDefaultSimulationFilterShader;
+	sceneDesc.filterShader = ContactFilterShader;
+	sceneDesc.flags |= PxSceneFlag::eENABLE_CCD;
+	sceneDesc.broadPhaseType = broadPhaseType;
 
 	_scene = _physics->createScene(sceneDesc);
+
+	if (broadPhaseType == PxBroadPhaseType::eMBP)
+	{
+		// PhysX 4 does not place MBP regions itself, the world box is split into a grid of them
+		PxBounds3 regions[kBroadPhaseRegionSubdivisions * kBroadPhaseRegionSubdivisions];
+		const auto regionCount = PxBroadPhaseExt::createRegionsFromWorldBounds(
+			regions,
+			PxBounds3(PxVec3(-WorldHalfExtent), PxVec3(WorldHalfExtent)),
+			kBroadPhaseRegionSubdivisions);
+		for (PxU32 i = 0; i < regionCount; i++)
+		{
+			_scene->addBroadPhaseRegion(PxBroadPhaseRegion{ regions[i], nullptr });
+		}
+	}
+
 	_material = _physics->createMaterial(0.5f, 0.5f, 0.6f);
 
 	// World
@@ -29,14 +154,20 @@ PhysicsScene::PhysicsScene()
 	World = PxCreateKinematic(*_physics, transform1, geometry1, *_material, 10.0f);
 	World->setRigidBodyFlag(PxRigidBodyFlag::eKINEMATIC, true);
 
+	// only the anchor of the booster joint, nothing collides with it or finds it in a query
 	PxShape* shapes[1];
 	World->getShapes(shapes, 1);
 	shapes[0]->setFlag(PxShapeFlag::eSIMULATION_SHAPE, false);
+	shapes[0]->setFlag(PxShapeFlag::eSCENE_QUERY_SHAPE, false);
 
 	// Camera
 	auto transform2 = PxTransform(PxVec3(0.0f));  // Starting position
 	auto geometry2 = PxSphereGeometry(1.0f);
 	Camera = PxCreateDynamic(*_physics, transform2, geometry2, *_material, 10.0f);
+	// the ship is the only thing fast and small enough to tunnel through an asteroid in one step
+	Camera->setRigidBodyFlag(PxRigidBodyFlag::eENABLE_CCD, true);
+	Camera->getShapes(shapes, 1);
+	shapes[0]->setQueryFilterData(PxFilterData(kQueryGroupShip, 0, 0, 0));
 
 	// Booster
 	Booster = PxD6JointCreate(*_physics,
@@ -69,26 +200,234 @@ PhysicsScene::PhysicsScene()
 
 	_scene->addActor(*World);
 	_scene->addActor(*Camera);
+
+	_snapshots[0].Camera = Camera->getGlobalPose();
+	_snapshots[1].Camera = _snapshots[0].Camera;
+	_interpolatedSnapshot = _snapshots[0];
 }
 
 PhysicsScene::~PhysicsScene()
 {
+	WaitForQueries();
+	if (_isSimulating)
+	{
+		_scene->fetchResults(true);
+	}
+
 	PX_RELEASE(_scene);
-	PX_RELEASE(_dispatcher);
+	delete _dispatcher;
+	_dispatcher = nullptr;
 	PX_RELEASE(_physics);
 	PX_RELEASE(_foundation);
 }
 
-void PhysicsScene::Step(PxReal deltaTime) const
+void PhysicsScene::AddAsteroids(const std::vector<glm::mat4>& models)
+{
+	PROFILE_SCOPE("PhysicsScene::AddAsteroids");
+
+	// actors cannot be added while the scene simulates or is queried
+	WaitForQueries();
+	if (_isSimulating)
+	{
+		FetchResults();
+	}
+
+	std::map<std::tuple<s32, s32, s32>, std::vector<PxRigidStatic*>> cells;
+	for (const auto& model : models)
+	{
+		const auto position = glm::vec3(model[3]);
+		const auto scale = glm::length(glm::vec3(model[0]));
+		const auto orientation = glm::quat_cast(glm::mat3(model) / scale);
+
+		const auto pose = PxTransform(
+			PxVec3(position.x, position.y, position.z),
+			PxQuat(orientation.x, orientation.y, orientation.z, orientation.w));
+		const auto asteroid = PxCreateStatic(*_physics, pose, PxBoxGeometry(PxVec3(0.5f * scale)), *_material);
+		PxShape* shape;
+		asteroid->getShapes(&shape, 1);
+		shape->setQueryFilterData(PxFilterData(kQueryGroupAsteroid, 0, 0, 0));
+
+		const auto cell = glm::ivec3(glm::floor(position / kAsteroidCellSize));
+		cells[{ cell.x, cell.y, cell.z }].push_back(asteroid);
+	}
+
+	u32 aggregateCount = 0;
+	for (const auto& [cell, asteroids] : cells)
+	{
+		// crowded cells get more than one aggregate
+		for (std::size_t first = 0; first < asteroids.size(); first += kMaxActorsPerAggregate)
+		{
+			const auto count = std::min(asteroids.size() - first, static_cast<std::size_t>(kMaxActorsPerAggregate));
+
+			// asteroids never move, pairs among them would only be thrown away
+			auto aggregate = _physics->createAggregate(static_cast<PxU32>(count), false);
+			for (std::size_t i = 0; i < count; i++)
+			{
+				aggregate->addActor(*asteroids[first + i]);
+			}
+			_scene->addAggregate(*aggregate);
+			aggregateCount++;
+		}
+	}
+
+	_asteroidCount += static_cast<u32>(models.size());
+	std::clog << "PHYSX: Added " << models.size() << " asteroids in " << aggregateCount << " aggregates.\n";
+}
+
+u32 PhysicsScene::AsteroidCount() const
+{
+	return _asteroidCount;
+}
+
+void PhysicsScene::SubmitQueries(const PhysicsQueryBatch& batch)
+{
+	PROFILE_SCOPE("PhysicsScene::SubmitQueries");
+	const auto queryGroups = QueryGroups(batch);
+
+	for (u32 first = 0; first < batch.RaycastCount; first += kQueriesPerJob)
+	{
+		const auto count = std::min(batch.RaycastCount - first, kQueriesPerJob);
+		_threadPool.Submit([this, queries = batch.Raycasts + first, hits = batch.RaycastHits + first, count, queryGroups]()
+		{
+			RunRaycasts(*_scene, queries, hits, count, queryGroups);
+		}, &_queryJobs);
+	}
+
+	for (u32 first = 0; first < batch.SweepCount; first += kQueriesPerJob)
+	{
+		const auto count = std::min(batch.SweepCount - first, kQueriesPerJob);
+		_threadPool.Submit([this, queries = batch.Sweeps + first, hits = batch.SweepHits + first, count, queryGroups]()
+		{
+			RunSweeps(*_scene, queries, hits, count, queryGroups);
+		}, &_queryJobs);
+	}
+
+	for (u32 first = 0; first < batch.OverlapCount; first += kQueriesPerJob)
+	{
+		const auto count = std::min(batch.OverlapCount - first, kQueriesPerJob);
+		_threadPool.Submit([this, queries = batch.Overlaps + first, hits = batch.OverlapHits + first, count, queryGroups]()
+		{
+			RunOverlaps(*_scene, queries, hits, count, queryGroups);
+		}, &_queryJobs);
+	}
+}
+
+bool PhysicsScene::AreQueriesDone() const
+{
+	return _queryJobs.IsDone();
+}
+
+void PhysicsScene::WaitForQueries()
+{
+	if (!_queryJobs.IsDone())
+	{
+		PROFILE_SCOPE("PhysicsScene::WaitForQueries");
+		_threadPool.Wait(_queryJobs);
+	}
+}
+
+void PhysicsScene::SetPipelined(const bool isPipelined)
+{
+	if (!isPipelined && _isSimulating)
+	{
+		FetchResults();
+	}
+	_isPipelined = isPipelined;
+}
+
+void PhysicsScene::SetFixedTimeStep(const f32 stepSeconds, const u32 maxSubsteps)
+{
+	_fixedTimeStep = stepSeconds;
+	_maxSubsteps = maxSubsteps > 0 ? maxSubsteps : 1;
+}
+
+void PhysicsScene::Advance(const f32 deltaTime)
+{
+	PROFILE_SCOPE("PhysicsScene::Advance");
+	_accumulator += deltaTime;
+
+	// a frame long enough to need more steps than allowed only runs the allowed ones. The rest is dropped,
+	// the world runs slower than real time for a moment instead of every following frame getting longer
+	const auto maxAccumulator = _fixedTimeStep * static_cast<f32>(_maxSubsteps);
+	if (_accumulator > maxAccumulator)
+	{
+		_droppedSeconds += _accumulator - maxAccumulator;
+		_accumulator = maxAccumulator;
+	}
+
+	while (_accumulator >= _fixedTimeStep)
+	{
+		Step(_fixedTimeStep);
+		_accumulator -= _fixedTimeStep;
+	}
+
+	Interpolate(_accumulator / _fixedTimeStep);
+}
+
+f32 PhysicsScene::DroppedSeconds() const
+{
+	return _droppedSeconds;
+}
+
+void PhysicsScene::Interpolate(const f32 alpha)
 {
+	const auto& previous = _snapshots[1 - _snapshotIndex].Camera;
+	const auto& current = _snapshots[_snapshotIndex].Camera;
+
+	const auto position = glm::mix(glm::vec3(previous.p.x, previous.p.y, previous.p.z), glm::vec3(current.p.x, current.p.y, current.p.z), alpha);
+	const auto orientation = glm::slerp(glm::quat(previous.q.w, previous.q.x, previous.q.y, previous.q.z), glm::quat(current.q.w, current.q.x, current.q.y, current.q.z), alpha);
+
+	_interpolatedSnapshot.Camera = PxTransform(
+		PxVec3(position.x, position.y, position.z),
+		PxQuat(orientation.x, orientation.y, orientation.z, orientation.w));
+}
+
+void PhysicsScene::Step(PxReal deltaTime)
+{
+	PROFILE_SCOPE("PhysicsScene::Step");
+	// queries read the scene, nothing may write to it before they are done
+	WaitForQueries();
+	if (_isSimulating)
+	{
+		FetchResults();
+	}
+
+	// thrust changed by input since the last step, the scene must not be written to while it simulates
+	Booster->setDriveVelocity(LinearThrust, AngularThrust);
+
 	_scene->simulate(deltaTime);
-	_scene->fetchResults(true);
+	_isSimulating = true;
+	if (!_isPipelined)
+	{
+		FetchResults();
+	}
+}
+
+const PhysicsSnapshot& PhysicsScene::Snapshot() const
+{
+	return _interpolatedSnapshot;
+}
+
+void PhysicsScene::FetchResults()
+{
+	{
+		// only waits when the simulation takes longer than everything else in the frame
+		PROFILE_SCOPE("PhysicsScene::FetchResults");
+		WaitForQueries();
+		_scene->fetchResults(true);
+		_isSimulating = false;
+	}
+
+	// written to the buffer nobody reads, then published
+	const auto nextSnapshotIndex = 1 - _snapshotIndex;
+	_snapshots[nextSnapshotIndex].Camera = Camera->getGlobalPose();
+	_snapshotIndex = nextSnapshotIndex;
 }
 
 void PhysicsScene::Boost(Direction direction, f32 acceleration)
 {
 	// Move relative facing direction
-	const auto quat = Camera->getGlobalPose().q;
+	const auto quat = Snapshot().Camera.q;
 	const auto xaxis = quat.getBasisVector0();
 	const auto yaxis = quat.getBasisVector1();
 	const auto zaxis = quat.getBasisVector2();
@@ -133,7 +472,6 @@ void PhysicsScene::Boost(Direction direction, f32 acceleration)
 
 	//std::clog << "LinearThrust (" << LinearThrust.x << ", " << LinearThrust.y << ", " << LinearThrust.z << ")" << std::endl;
 	//std::clog << "AngularThrust (" << AngularThrust.x << ", " << AngularThrust.y << ", " << AngularThrust.z << ")" << std::endl;
-	Booster->setDriveVelocity(LinearThrust, AngularThrust);
 }
 
 void PhysicsScene::Tumble(const float x, const float y)
@@ -142,5 +480,4 @@ void PhysicsScene::Tumble(const float x, const float y)
 
 	AngularThrust.x += y * sensitivity;
 	AngularThrust.y += x * sensitivity;
-	Booster->setDriveVelocity(LinearThrust, AngularThrust);
 }
@@ -1,10 +1,17 @@
 #pragma once
 
+#include "threading/threadpool.hpp"
 #include "types.hpp"
 
 #include <PxConfig.h>
 #include <PxPhysicsAPI.h>
 
+#include <glm/mat4x4.hpp>
+
+#include <array>
+#include <vector>
+
+class PhysicsDispatcher;
 
 #define PX_RELEASE(x) if(x) { x->release(); x = nullptr; }
 
@@ -21,16 +28,117 @@ enum class Direction
 	Stop
 };
 
+// poses the rest of the frame reads, copied out of the scene after each fetchResults
+struct PhysicsSnapshot
+{
+	physx::PxTransform Camera{ physx::PxIdentity };
+};
+
+struct RaycastQuery
+{
+	physx::PxVec3 Origin{ 0.0f, 0.0f, 0.0f };
+	// normalized
+	physx::PxVec3 Direction{ 0.0f, 0.0f, -1.0f };
+	f32 Distance = 0.0f;
+};
+
+// a sphere moved along Direction, what collision avoidance looks ahead with
+struct SweepQuery
+{
+	physx::PxVec3 Origin{ 0.0f, 0.0f, 0.0f };
+	f32 Radius = 1.0f;
+	// normalized
+	physx::PxVec3 Direction{ 0.0f, 0.0f, -1.0f };
+	f32 Distance = 0.0f;
+};
+
+// everything within a sphere, what proximity sensors use
+struct OverlapQuery
+{
+	physx::PxVec3 Center{ 0.0f, 0.0f, 0.0f };
+	f32 Radius = 1.0f;
+};
+
+// the closest hit of a raycast or sweep
+struct QueryHit
+{
+	physx::PxRigidActor* Actor = nullptr;
+	physx::PxVec3 Position{ 0.0f, 0.0f, 0.0f };
+	physx::PxVec3 Normal{ 0.0f, 0.0f, 0.0f };
+	f32 Distance = 0.0f;
+	bool IsHit = false;
+};
+
+struct OverlapHit
+{
+	static constexpr u32 MaxActors = 8;
+
+	// the first ActorCount entries, further actors in the sphere are not reported
+	std::array<physx::PxRigidActor*, MaxActors> Actors{};
+	u32 ActorCount = 0;
+};
+
+// Queries and the buffers their results go to, one result per query at the same index. The scene only
+// keeps the pointers, queries and results have to stay alive until the batch is done
+struct PhysicsQueryBatch
+{
+	const RaycastQuery* Raycasts = nullptr;
+	QueryHit* RaycastHits = nullptr;
+	u32 RaycastCount = 0;
+
+	const SweepQuery* Sweeps = nullptr;
+	QueryHit* SweepHits = nullptr;
+	u32 SweepCount = 0;
+
+	const OverlapQuery* Overlaps = nullptr;
+	OverlapHit* OverlapHits = nullptr;
+	u32 OverlapCount = 0;
+
+	// queries only see the asteroids unless set, the ship itself is hit or touched then as well
+	bool IncludesShip = false;
+};
+
 class PhysicsScene
 {
 public:
-	PhysicsScene();
+	// PhysX tasks run on threadPool, the scene brings no threads of its own.
+	// MBP only sees what is inside its regions, they cover WorldHalfExtent around the origin
+	explicit PhysicsScene(ThreadPool& threadPool, physx::PxBroadPhaseType::Enum broadPhaseType = physx::PxBroadPhaseType::eABP);
 	~PhysicsScene();
 
-	void Step(physx::PxReal deltaTime) const;
+	static constexpr f32 WorldHalfExtent = 2048.0f;
+
+	// one static box per unit cube instance, models are translation * rotation * uniform scale like the
+	// asteroid instances. They are grouped into an aggregate per grid cell, the broadphase tracks the cell
+	// bounds and only looks at single asteroids once something flies into a cell
+	void AddAsteroids(const std::vector<glm::mat4>& models);
+	[[nodiscard]] u32 AsteroidCount() const;
+
+	// Pipelined, a step collects the results of the simulation the previous step started and starts the
+	// next one, which then runs on the PhysX workers while the frame is rendered. Poses lag one step behind.
+	// Otherwise a step simulates and waits for the results
+	void SetPipelined(bool isPipelined);
+	// the simulation always advances by stepSeconds, a frame runs at most maxSubsteps of them
+	void SetFixedTimeStep(f32 stepSeconds, u32 maxSubsteps);
+	// runs as many fixed steps as the accumulated frame time allows and interpolates the snapshot
+	// for the time left over
+	void Advance(f32 deltaTime);
 	void Boost(Direction direction, f32 acceleration);
 	void Tumble(f32 x, f32 y);
 
+	// Runs the queries on the thread pool, in chunks, while the caller goes on with the frame. They see the
+	// scene as of the last completed step, also while the next one simulates. The next step waits for every
+	// submitted batch before it fetches results, so a batch has until then to finish
+	void SubmitQueries(const PhysicsQueryBatch& batch);
+	[[nodiscard]] bool AreQueriesDone() const;
+	// helps running the query jobs until every submitted batch is done
+	void WaitForQueries();
+
+	// between the last two completed steps, stays valid and unchanged while the next one simulates
+	[[nodiscard]] const PhysicsSnapshot& Snapshot() const;
+	// frame time thrown away because the simulation could not keep up, see Advance
+	[[nodiscard]] f32 DroppedSeconds() const;
+
 	physx::PxD6Joint* Booster;
 	physx::PxRigidDynamic* Camera;
 	physx::PxRigidDynamic* World;
@@ -45,10 +153,31 @@ private:
 	physx::PxFoundation* _foundation = nullptr;
 	physx::PxPhysics* _physics = nullptr;
 
-	physx::PxDefaultCpuDispatcher* _dispatcher = nullptr;
+	PhysicsDispatcher* _dispatcher = nullptr;
 	physx::PxScene* _scene = nullptr;
 
 	physx::PxMaterial* _material = nullptr;
 
 	physx::PxPvd* _visualDebugger = nullptr;
+
+	ThreadPool& _threadPool;
+	JobCounter _queryJobs;
+
+	void Step(physx::PxReal deltaTime);
+	void FetchResults();
+	void Interpolate(f32 alpha);
+
+	u32 _asteroidCount = 0;
+
+	bool _isPipelined = false;
+	bool _isSimulating = false;
+	// the last two completed steps, _snapshotIndex is the newer one
+	std::array<PhysicsSnapshot, 2> _snapshots{};
+	u32 _snapshotIndex = 0;
+	PhysicsSnapshot _interpolatedSnapshot{};
+
+	f32 _fixedTimeStep = 1.0f / 60.0f;
+	u32 _maxSubsteps = 4;
+	f32 _accumulator = 0.0f;
+	f32 _droppedSeconds = 0.0f;
 };
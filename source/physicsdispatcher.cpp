@@ -0,0 +1,25 @@
+#include "physicsdispatcher.hpp"
+#include "profiling/cpuprofiler.hpp"
+#include "threading/threadpool.hpp"
+
+PhysicsDispatcher::PhysicsDispatcher(ThreadPool& threadPool)
+    : _threadPool{ threadPool }
+{
+}
+
+void PhysicsDispatcher::submitTask(physx::PxBaseTask& task)
+{
+    // PhysX only submits tasks whose dependencies are done, running one never waits on another
+    _threadPool.Submit([&task]()
+    {
+        PROFILE_SCOPE(task.getName());
+        task.run();
+        task.release();
+    });
+}
+
+uint32_t PhysicsDispatcher::getWorkerCount() const
+{
+    // PhysX sizes how finely it splits islands and solver batches by this
+    return _threadPool.WorkerCount();
+}
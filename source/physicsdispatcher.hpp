@@ -0,0 +1,22 @@
+#pragma once
+
+#include "types.hpp"
+
+#include <PxConfig.h>
+#include <PxPhysicsAPI.h>
+
+class ThreadPool;
+
+// Hands PhysX tasks to the engine's thread pool instead of letting PhysX spawn workers of its own,
+// so simulation, culling and asset jobs share one set of threads sized to the machine
+class PhysicsDispatcher final : public physx::PxCpuDispatcher
+{
+public:
+    explicit PhysicsDispatcher(ThreadPool& threadPool);
+
+    void submitTask(physx::PxBaseTask& task) override;
+    [[nodiscard]] uint32_t getWorkerCount() const override;
+
+private:
+    ThreadPool& _threadPool;
+};
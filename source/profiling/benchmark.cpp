@@ -0,0 +1,159 @@
+#include "profiling/benchmark.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+
+namespace
+{
+    f32 Percentile(const std::vector<f32>& sortedValues, const f64 percentile)
+    {
+        if (sortedValues.empty())
+        {
+            return 0.0f;
+        }
+
+        const auto index = static_cast<size_t>(percentile * static_cast<f64>(sortedValues.size() - 1) + 0.5);
+        return sortedValues[std::min(index, sortedValues.size() - 1)];
+    }
+
+    void WriteJsonString(std::ofstream& file, const std::string& value)
+    {
+        file << '"';
+        for (const auto character : value)
+        {
+            if (character == '"' || character == '\\')
+            {
+                file << '\\';
+            }
+            file << character;
+        }
+        file << '"';
+    }
+}
+
+CameraPath::CameraPath(std::vector<glm::vec3> controlPoints)
+    : _controlPoints{ std::move(controlPoints) }
+{
+}
+
+CameraPath CameraPath::CreateDefault()
+{
+    return CameraPath(
+    {
+        glm::vec3(0.0f, 4.0f, 30.0f),
+        glm::vec3(25.0f, 10.0f, 18.0f),
+        glm::vec3(40.0f, 2.0f, -10.0f),
+        glm::vec3(10.0f, -6.0f, -35.0f),
+        glm::vec3(-20.0f, 0.0f, -25.0f),
+        glm::vec3(-35.0f, 12.0f, 5.0f),
+        glm::vec3(-12.0f, 6.0f, 22.0f)
+    });
+}
+
+CameraPose CameraPath::Evaluate(const f32 t) const
+{
+    // look a little ahead along the curve instead of differentiating it
+    auto constexpr lookAhead = 0.005f;
+
+    const auto position = Position(t);
+    const auto direction = glm::normalize(Position(t + lookAhead) - position);
+    return { position, direction };
+}
+
+glm::vec3 CameraPath::Position(const f32 t) const
+{
+    const auto pointCount = static_cast<s32>(_controlPoints.size());
+    const auto wrapped = t - std::floor(t);
+    const auto scaled = wrapped * static_cast<f32>(pointCount);
+    const auto segment = static_cast<s32>(scaled);
+    const auto s = scaled - static_cast<f32>(segment);
+
+    const auto& p0 = _controlPoints[(segment + pointCount - 1) % pointCount];
+    const auto& p1 = _controlPoints[segment % pointCount];
+    const auto& p2 = _controlPoints[(segment + 1) % pointCount];
+    const auto& p3 = _controlPoints[(segment + 2) % pointCount];
+
+    const auto s2 = s * s;
+    const auto s3 = s2 * s;
+    return 0.5f * ((2.0f * p1) +
+        (-p0 + p2) * s +
+        (2.0f * p0 - 5.0f * p1 + 4.0f * p2 - p3) * s2 +
+        (-p0 + 3.0f * p1 - 3.0f * p2 + p3) * s3);
+}
+
+BenchmarkRecorder::BenchmarkRecorder(const BenchmarkSettings& settings)
+    : _settings{ settings }
+{
+    _frameMilliseconds.reserve(settings.FrameCount);
+}
+
+void BenchmarkRecorder::AddFrame(const f32 frameMilliseconds)
+{
+    _frameMilliseconds.push_back(frameMilliseconds);
+}
+
+bool BenchmarkRecorder::WriteReport(
+    const std::string& renderer,
+    const std::string& version,
+    const u32 framesInFlight,
+    const std::vector<GpuProfilerStatistics>& passStatistics) const
+{
+    std::ofstream file(_settings.ReportFilePath);
+    if (!file)
+    {
+        std::cerr << "Benchmark: Unable to write " << _settings.ReportFilePath << '\n';
+        return false;
+    }
+
+    auto sorted = _frameMilliseconds;
+    std::sort(sorted.begin(), sorted.end());
+
+    auto sum = 0.0;
+    for (const auto frameMilliseconds : sorted)
+    {
+        sum += frameMilliseconds;
+    }
+    const auto average = sorted.empty() ? 0.0 : sum / static_cast<f64>(sorted.size());
+
+    file << std::fixed << std::setprecision(4);
+    file << "{\n";
+    file << "  \"renderer\": ";
+    WriteJsonString(file, renderer);
+    file << ",\n  \"version\": ";
+    WriteJsonString(file, version);
+    file << ",\n  \"width\": " << _settings.Width
+        << ",\n  \"height\": " << _settings.Height
+        << ",\n  \"frames\": " << sorted.size()
+        << ",\n  \"warmup_frames\": " << _settings.WarmupFrameCount
+        << ",\n  \"frames_in_flight\": " << framesInFlight
+        << ",\n  \"frame_time_ms\": {"
+        << " \"min\": " << (sorted.empty() ? 0.0f : sorted.front())
+        << ", \"avg\": " << average
+        << ", \"p50\": " << Percentile(sorted, 0.50)
+        << ", \"p90\": " << Percentile(sorted, 0.90)
+        << ", \"p95\": " << Percentile(sorted, 0.95)
+        << ", \"p99\": " << Percentile(sorted, 0.99)
+        << ", \"max\": " << (sorted.empty() ? 0.0f : sorted.back())
+        << " },\n";
+
+    file << "  \"passes\": [\n";
+    for (size_t i = 0; i < passStatistics.size(); i++)
+    {
+        const auto& statistic = passStatistics[i];
+        file << "    { \"name\": ";
+        WriteJsonString(file, statistic.Name);
+        file << ", \"min_ms\": " << statistic.MinMilliseconds
+            << ", \"avg_ms\": " << statistic.AverageMilliseconds
+            << ", \"p99_ms\": " << statistic.P99Milliseconds
+            << ", \"samples\": " << statistic.SampleCount << " }"
+            << (i + 1 < passStatistics.size() ? ",\n" : "\n");
+    }
+    file << "  ]\n}\n";
+
+    std::clog << "Benchmark: " << sorted.size() << " frames, avg " << average << "ms, p99 " << Percentile(sorted, 0.99)
+        << "ms, report written to " << _settings.ReportFilePath << '\n';
+    return true;
+}
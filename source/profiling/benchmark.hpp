@@ -0,0 +1,64 @@
+#pragma once
+
+#include "types.hpp"
+#include "graphics/gpuprofiler.hpp"
+
+#include <glm/glm.hpp>
+
+#include <filesystem>
+#include <string>
+#include <vector>
+
+struct BenchmarkSettings
+{
+    u32 FrameCount{ 1000 };
+    // frames rendered before recording starts, they absorb shader compilation and first touch uploads
+    u32 WarmupFrameCount{ 60 };
+    u32 Width{ 1920 };
+    u32 Height{ 1080 };
+    // simulation step per frame, fixed so every run sees the same scene and camera
+    f32 DeltaTime{ 1.0f / 60.0f };
+    std::filesystem::path ReportFilePath{ "benchmark.json" };
+};
+
+struct CameraPose
+{
+    glm::vec3 Position;
+    glm::vec3 Direction;
+};
+
+// Closed catmull-rom spline through a set of camera positions, the camera looks along the curve
+class CameraPath final
+{
+public:
+    explicit CameraPath(std::vector<glm::vec3> controlPoints);
+
+    // the loop through the space scene the benchmark flies
+    static CameraPath CreateDefault();
+
+    // t in [0, 1) covers the whole loop once
+    [[nodiscard]] CameraPose Evaluate(const f32 t) const;
+
+private:
+    [[nodiscard]] glm::vec3 Position(const f32 t) const;
+
+    std::vector<glm::vec3> _controlPoints;
+};
+
+class BenchmarkRecorder final
+{
+public:
+    explicit BenchmarkRecorder(const BenchmarkSettings& settings);
+
+    void AddFrame(const f32 frameMilliseconds);
+
+    bool WriteReport(
+        const std::string& renderer,
+        const std::string& version,
+        const u32 framesInFlight,
+        const std::vector<GpuProfilerStatistics>& passStatistics) const;
+
+private:
+    BenchmarkSettings _settings;
+    std::vector<f32> _frameMilliseconds;
+};
@@ -0,0 +1,206 @@
+#include "profiling/cpuprofiler.hpp"
+
+#include <iostream>
+
+#if EMPTYSPACE_ENABLE_PROFILER
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace
+{
+    struct CpuProfileEvent
+    {
+        const char* Name;
+        u64 BeginNanoseconds;
+        u64 EndNanoseconds;
+    };
+
+    // a ring slot, atomic so WriteChromeTrace can copy it while its thread overwrites it
+    struct RecordedEvent
+    {
+        std::atomic<const char*> Name{ nullptr };
+        std::atomic<u64> BeginNanoseconds{ 0 };
+        std::atomic<u64> EndNanoseconds{ 0 };
+    };
+
+    struct ThreadEvents
+    {
+        std::string Name;
+        u32 ThreadIndex{};
+        std::unique_ptr<RecordedEvent[]> Events;
+        // raised before a slot is written, events below StartedEventCount - EventsPerThread may be overwritten
+        std::atomic<u64> StartedEventCount{ 0 };
+        // raised after, events below it are complete
+        std::atomic<u64> EventCount{ 0 };
+        // begin timestamps of the open scopes
+        std::vector<std::pair<const char*, u64>> OpenScopes;
+    };
+
+    std::mutex g_ThreadEventsMutex;
+    // entries stay alive after their thread exits so the trace still contains its events
+    std::vector<std::unique_ptr<ThreadEvents>> g_ThreadEvents;
+    const auto g_StartTime = std::chrono::steady_clock::now();
+
+    thread_local ThreadEvents* t_ThreadEvents{ nullptr };
+
+    u64 Now()
+    {
+        return static_cast<u64>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - g_StartTime).count());
+    }
+
+    ThreadEvents& CurrentThreadEvents()
+    {
+        if (t_ThreadEvents == nullptr)
+        {
+            auto threadEvents = std::make_unique<ThreadEvents>();
+            threadEvents->Events = std::make_unique<RecordedEvent[]>(CpuProfiler::EventsPerThread);
+            threadEvents->OpenScopes.reserve(64);
+
+            const std::lock_guard lock(g_ThreadEventsMutex);
+            threadEvents->ThreadIndex = static_cast<u32>(g_ThreadEvents.size());
+            threadEvents->Name = "Thread " + std::to_string(threadEvents->ThreadIndex);
+            t_ThreadEvents = threadEvents.get();
+            g_ThreadEvents.push_back(std::move(threadEvents));
+        }
+
+        return *t_ThreadEvents;
+    }
+
+    void WriteJsonString(std::ofstream& file, const std::string_view value)
+    {
+        file << '"';
+        for (const auto character : value)
+        {
+            if (character == '"' || character == '\\')
+            {
+                file << '\\';
+            }
+            file << character;
+        }
+        file << '"';
+    }
+}
+
+void CpuProfiler::SetThreadName(const std::string_view name)
+{
+    auto& threadEvents = CurrentThreadEvents();
+
+    const std::lock_guard lock(g_ThreadEventsMutex);
+    threadEvents.Name = name;
+}
+
+void CpuProfiler::BeginScope(const char* name)
+{
+    CurrentThreadEvents().OpenScopes.emplace_back(name, Now());
+}
+
+void CpuProfiler::EndScope()
+{
+    const auto endTime = Now();
+    auto& threadEvents = CurrentThreadEvents();
+    if (threadEvents.OpenScopes.empty())
+    {
+        return;
+    }
+
+    const auto [name, beginTime] = threadEvents.OpenScopes.back();
+    threadEvents.OpenScopes.pop_back();
+
+    // a reader that sees any of the slot stores also sees the started count, see WriteChromeTrace
+    const auto eventIndex = threadEvents.EventCount.load(std::memory_order_relaxed);
+    threadEvents.StartedEventCount.store(eventIndex + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    auto& event = threadEvents.Events[eventIndex % EventsPerThread];
+    event.Name.store(name, std::memory_order_relaxed);
+    event.BeginNanoseconds.store(beginTime, std::memory_order_relaxed);
+    event.EndNanoseconds.store(endTime, std::memory_order_relaxed);
+    threadEvents.EventCount.store(eventIndex + 1, std::memory_order_release);
+}
+
+bool CpuProfiler::WriteChromeTrace(const std::filesystem::path& filePath)
+{
+    std::ofstream file(filePath);
+    if (!file)
+    {
+        std::cerr << "CpuProfiler: Unable to write " << filePath << '\n';
+        return false;
+    }
+
+    // Other threads keep recording while this runs. Only completed events are copied, and those the ring
+    // wrapped around onto during the copy are dropped afterwards
+    const std::lock_guard lock(g_ThreadEventsMutex);
+    std::vector<CpuProfileEvent> events;
+    events.reserve(EventsPerThread);
+
+    file << std::fixed << std::setprecision(3);
+    file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    auto isFirstEvent = true;
+    for (const auto& threadEvents : g_ThreadEvents)
+    {
+        file << (isFirstEvent ? "" : ",\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << threadEvents->ThreadIndex << ",\"args\":{\"name\":";
+        WriteJsonString(file, threadEvents->Name);
+        file << "}}";
+        isFirstEvent = false;
+
+        const auto eventCount = threadEvents->EventCount.load(std::memory_order_acquire);
+        const auto firstEvent = eventCount > EventsPerThread ? eventCount - EventsPerThread : 0;
+        events.clear();
+        for (auto eventIndex = firstEvent; eventIndex < eventCount; eventIndex++)
+        {
+            const auto& event = threadEvents->Events[eventIndex % EventsPerThread];
+            events.push_back({
+                event.Name.load(std::memory_order_relaxed),
+                event.BeginNanoseconds.load(std::memory_order_relaxed),
+                event.EndNanoseconds.load(std::memory_order_relaxed) });
+        }
+
+        // pairs with the fence in EndScope, a slot copied while it was overwritten shows up in the started count
+        std::atomic_thread_fence(std::memory_order_acquire);
+        const auto startedEventCount = threadEvents->StartedEventCount.load(std::memory_order_relaxed);
+        const auto firstIntactEvent = std::max(firstEvent, startedEventCount > EventsPerThread ? startedEventCount - EventsPerThread : 0);
+
+        for (auto eventIndex = firstIntactEvent; eventIndex < eventCount; eventIndex++)
+        {
+            const auto& event = events[eventIndex - firstEvent];
+            file << ",\n{\"name\":";
+            WriteJsonString(file, event.Name);
+            file << ",\"ph\":\"X\",\"pid\":1,\"tid\":" << threadEvents->ThreadIndex
+                << ",\"ts\":" << static_cast<f64>(event.BeginNanoseconds) / 1000.0
+                << ",\"dur\":" << static_cast<f64>(event.EndNanoseconds - event.BeginNanoseconds) / 1000.0 << '}';
+        }
+    }
+    file << "\n]}\n";
+
+    return true;
+}
+
+#else
+
+void CpuProfiler::SetThreadName(const std::string_view /*name*/)
+{
+}
+
+void CpuProfiler::BeginScope(const char* /*name*/)
+{
+}
+
+void CpuProfiler::EndScope()
+{
+}
+
+bool CpuProfiler::WriteChromeTrace(const std::filesystem::path& /*filePath*/)
+{
+    std::cerr << "CpuProfiler: Built without EMPTYSPACE_ENABLE_PROFILER, nothing to write\n";
+    return false;
+}
+
+#endif
@@ -0,0 +1,56 @@
+#pragma once
+
+#include "types.hpp"
+
+#include <filesystem>
+#include <string_view>
+
+// Cpu scope profiler. Scopes are recorded into a ring buffer owned by the thread that ran them
+// and can be written out as chrome trace event json (chrome://tracing, ui.perfetto.dev).
+// Without EMPTYSPACE_ENABLE_PROFILER the macros expand to nothing and no timestamps are taken.
+class CpuProfiler final
+{
+public:
+    // events kept per thread, older ones are overwritten
+    static constexpr u32 EventsPerThread = 1u << 16;
+
+    static void SetThreadName(const std::string_view name);
+    static void BeginScope(const char* name);
+    static void EndScope();
+
+    // returns false when the profiler is compiled out or the file cannot be written
+    static bool WriteChromeTrace(const std::filesystem::path& filePath);
+};
+
+#if EMPTYSPACE_ENABLE_PROFILER
+
+class CpuProfileScope final
+{
+public:
+    explicit CpuProfileScope(const char* name)
+    {
+        CpuProfiler::BeginScope(name);
+    }
+
+    ~CpuProfileScope()
+    {
+        CpuProfiler::EndScope();
+    }
+
+    CpuProfileScope(const CpuProfileScope&) = delete;
+    CpuProfileScope& operator=(const CpuProfileScope&) = delete;
+};
+
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+#define PROFILE_SCOPE(name) const CpuProfileScope PROFILE_CONCAT(cpuProfileScope, __LINE__)(name)
+#define PROFILE_FUNCTION() PROFILE_SCOPE(__func__)
+#define PROFILE_THREAD(name) CpuProfiler::SetThreadName(name)
+
+#else
+
+#define PROFILE_SCOPE(name)
+#define PROFILE_FUNCTION()
+#define PROFILE_THREAD(name)
+
+#endif
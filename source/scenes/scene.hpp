@@ -1,11 +1,13 @@
 #pragma once
 
+#include <filesystem>
 #include <vector>
 
 #include "types.hpp"
 #include "camera.hpp"
 #include "graphics/light.hpp"
 #include "scenes/scenenode.hpp"
+#include "profiling/cpuprofiler.hpp"
 
 class Material;
 struct SceneObject;
@@ -34,6 +36,7 @@ public:
 
     inline void Update(const f32 deltaTime, const Camera& camera)
     {
+        PROFILE_SCOPE("Scene::Update");
         InternalUpdate(deltaTime, camera);
     }
 
@@ -47,6 +50,12 @@ public:
         return _objects;
     }
 
+    // recreates the texture loaded from filePath, false when the scene does not use that file
+    virtual bool ReloadTexture(const std::filesystem::path& /*filePath*/)
+    {
+        return false;
+    }
+
 protected:
     virtual void InternalDraw(f32 /*deltaTime*/)
     {
@@ -9,9 +9,19 @@
 #include <GLFW/glfw3.h>
 #include <glm/gtx/quaternion.hpp>
 
+#include <array>
+#include <string_view>
+#include <tuple>
+
 class SpaceScene : public Scene
 {
 public:
+	static constexpr u32 AsteroidCount = 5000;
+
+	static constexpr std::string_view DiffuseTextureFilePath = "data/textures/T_PlasticMesh_D.jpg";
+	static constexpr std::string_view SpecularTextureFilePath = "data/textures/T_PlasticMesh_S.jpg";
+	static constexpr std::string_view NormalTextureFilePath = "data/textures/T_PlasticMesh_N.jpg";
+
 	SpaceScene(GraphicsDevice& graphicsDevice)
 		: _graphicsDevice{ graphicsDevice }
 	{
@@ -50,6 +60,37 @@ public:
 		return _bufferAsteroids;
 	}
 
+	bool ReloadTexture(const std::filesystem::path& filePath) override
+	{
+		const std::array<std::tuple<Texture**, std::string_view, u32>, 3> textures
+		{
+			std::make_tuple(&_textureCubeDiffuse, DiffuseTextureFilePath, static_cast<u32>(STBI_rgb)),
+			std::make_tuple(&_textureCubeSpecular, SpecularTextureFilePath, static_cast<u32>(STBI_grey)),
+			std::make_tuple(&_textureCubeNormal, NormalTextureFilePath, static_cast<u32>(STBI_rgb))
+		};
+
+		// the new texture is created first, a file that fails to load leaves the old one in place
+		for (auto [texture, textureFilePath, component] : textures)
+		{
+			if (filePath.generic_string() == textureFilePath)
+			{
+				const auto reloadedTexture = _graphicsDevice.CreateTextureFromFile(textureFilePath, component);
+				_defaultMaterial->ReplaceTexture(*texture, reloadedTexture);
+				delete *texture;
+				*texture = reloadedTexture;
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+	// model matrices of the asteroids, the physics scene builds their colliders from the same ones
+	[[nodiscard]] const std::vector<glm::mat4>& GetAsteroidInstances() const
+	{
+		return _asteroidInstances;
+	}
+
 protected:
 	void InitializeLights()
 	{
@@ -65,15 +106,15 @@ protected:
 
 	void InitializeTextures()
 	{
-		_textureCubeDiffuse = _graphicsDevice.CreateTextureFromFile("data/textures/T_PlasticMesh_D.jpg", STBI_rgb);
-		_textureCubeSpecular = _graphicsDevice.CreateTextureFromFile("data/textures/T_PlasticMesh_S.jpg", STBI_grey);
-		_textureCubeNormal = _graphicsDevice.CreateTextureFromFile("data/textures/T_PlasticMesh_N.jpg", STBI_rgb);
+		_textureCubeDiffuse = _graphicsDevice.CreateTextureFromFile(DiffuseTextureFilePath, STBI_rgb);
+		_textureCubeSpecular = _graphicsDevice.CreateTextureFromFile(SpecularTextureFilePath, STBI_grey);
+		_textureCubeNormal = _graphicsDevice.CreateTextureFromFile(NormalTextureFilePath, STBI_rgb);
 
 		_defaultMaterial = new Material(_textureCubeDiffuse, _textureCubeNormal, _textureCubeSpecular);
 
-		auto const asteroidInstances = CreateAsteroidInstances(5000);
+		_asteroidInstances = CreateAsteroidInstances(AsteroidCount);
 
-		_bufferAsteroids = new Buffer(asteroidInstances);
+		_bufferAsteroids = new Buffer(_asteroidInstances);
 	}
 
 	void InternalDraw(f32 /*deltaTime*/) override
@@ -195,6 +236,7 @@ private:
 	Texture* _textureCubeSpecular{};
 	Texture* _textureCubeNormal{};
 
+	std::vector<glm::mat4> _asteroidInstances;
 	Buffer* _bufferAsteroids{};
 	std::vector<Scene*> _scenes;
 };
@@ -0,0 +1,87 @@
+#include "threading/jobgraph.hpp"
+#include "threading/threadpool.hpp"
+
+JobGraph::~JobGraph()
+{
+    Wait();
+}
+
+JobGraph::JobId JobGraph::Add(std::function<void()> job, const std::vector<JobId>& dependencies)
+{
+    const auto jobId = static_cast<JobId>(_nodes.size());
+    auto& node = _nodes.emplace_back();
+    node.Job = std::move(job);
+    node.DependencyCount = static_cast<u32>(dependencies.size());
+
+    for (const auto dependency : dependencies)
+    {
+        _nodes[dependency].Dependents.push_back(jobId);
+    }
+
+    return jobId;
+}
+
+void JobGraph::Clear()
+{
+    Wait();
+    _nodes.clear();
+}
+
+void JobGraph::Start(ThreadPool& threadPool)
+{
+    if (_nodes.empty())
+    {
+        return;
+    }
+
+    // counters are armed before anything runs, a fast job could otherwise release a dependent early
+    for (auto& node : _nodes)
+    {
+        node.PendingDependencies.store(node.DependencyCount, std::memory_order_relaxed);
+    }
+    _remainingJobs.store(static_cast<u32>(_nodes.size()), std::memory_order_release);
+    {
+        std::lock_guard lock(_mutex);
+        _isDoneSignalled = false;
+    }
+
+    for (JobId jobId = 0; jobId < _nodes.size(); jobId++)
+    {
+        if (_nodes[jobId].DependencyCount == 0)
+        {
+            threadPool.Submit([this, &threadPool, jobId]() { Run(threadPool, jobId); });
+        }
+    }
+}
+
+bool JobGraph::IsDone() const
+{
+    return _remainingJobs.load(std::memory_order_acquire) == 0;
+}
+
+void JobGraph::Wait()
+{
+    std::unique_lock lock(_mutex);
+    _doneCondition.wait(lock, [this]() { return _isDoneSignalled; });
+}
+
+void JobGraph::Run(ThreadPool& threadPool, const JobId jobId)
+{
+    auto& node = _nodes[jobId];
+    node.Job();
+
+    for (const auto dependent : node.Dependents)
+    {
+        if (_nodes[dependent].PendingDependencies.fetch_sub(1, std::memory_order_acq_rel) == 1)
+        {
+            threadPool.Submit([this, &threadPool, dependent]() { Run(threadPool, dependent); });
+        }
+    }
+
+    if (_remainingJobs.fetch_sub(1, std::memory_order_acq_rel) == 1)
+    {
+        std::lock_guard lock(_mutex);
+        _isDoneSignalled = true;
+        _doneCondition.notify_all();
+    }
+}
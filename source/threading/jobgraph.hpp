@@ -0,0 +1,54 @@
+#pragma once
+
+#include "types.hpp"
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+class ThreadPool;
+
+// Jobs with dependencies, run on the thread pool. Start submits the jobs without dependencies,
+// every finished job submits the dependents it was the last dependency of. The thread that
+// started the graph is free to do other work until it calls Wait
+class JobGraph final
+{
+public:
+    using JobId = u32;
+
+    JobGraph() = default;
+    ~JobGraph();
+
+    JobGraph(const JobGraph&) = delete;
+    JobGraph& operator=(const JobGraph&) = delete;
+
+    // only while the graph is not running
+    JobId Add(std::function<void()> job, const std::vector<JobId>& dependencies = {});
+    void Clear();
+
+    void Start(ThreadPool& threadPool);
+    [[nodiscard]] bool IsDone() const;
+    void Wait();
+
+private:
+    struct Node
+    {
+        std::function<void()> Job;
+        std::vector<JobId> Dependents;
+        u32 DependencyCount;
+        std::atomic<u32> PendingDependencies;
+    };
+
+    void Run(ThreadPool& threadPool, const JobId jobId);
+
+    // a deque keeps nodes in place while the graph grows, the atomics cannot move
+    std::deque<Node> _nodes;
+    std::atomic<u32> _remainingJobs{ 0 };
+    // set by the last job while holding the mutex, Wait returning means no job touches the graph anymore
+    bool _isDoneSignalled{ true };
+    std::mutex _mutex;
+    std::condition_variable _doneCondition;
+};
@@ -0,0 +1,48 @@
+#pragma once
+
+#include "types.hpp"
+
+#include <array>
+#include <atomic>
+
+// Bounded lock free queue for exactly one producer and one consumer thread. Head and tail
+// live on separate cache lines so both sides only share a line when they touch the same item
+template <typename T, u32 Capacity>
+class SpscQueue final
+{
+public:
+    static_assert(Capacity != 0 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+    // producer side, false when the queue is full
+    bool TryPush(const T& value)
+    {
+        const auto tail = _tail.load(std::memory_order_relaxed);
+        if (tail - _head.load(std::memory_order_acquire) == Capacity)
+        {
+            return false;
+        }
+
+        _items[tail & (Capacity - 1)] = value;
+        _tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // consumer side, false when the queue is empty
+    bool TryPop(T& value)
+    {
+        const auto head = _head.load(std::memory_order_relaxed);
+        if (head == _tail.load(std::memory_order_acquire))
+        {
+            return false;
+        }
+
+        value = _items[head & (Capacity - 1)];
+        _head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+private:
+    alignas(64) std::atomic<u32> _head{ 0 };
+    alignas(64) std::atomic<u32> _tail{ 0 };
+    alignas(64) std::array<T, Capacity> _items{};
+};
@@ -0,0 +1,447 @@
+#include "threading/threadpool.hpp"
+#include "threading/workstealingdeque.hpp"
+#include "profiling/cpuprofiler.hpp"
+
+#include <algorithm>
+#include <iostream>
+#include <string>
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#elif defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#endif
+
+namespace
+{
+    constexpr u32 kDequeCapacity = 4096;
+    constexpr u32 kJobsPerBlock = 256;
+    // rounds an idle worker keeps looking for work before it goes to sleep
+    constexpr u32 kIdleRoundsBeforeSleep = 64;
+    constexpr u32 kChunksPerThread = 4;
+}
+
+struct ThreadPool::Job
+{
+    std::function<void()> Work;
+    JobCounter* Counter{ nullptr };
+    Job* Next{ nullptr };
+    u32 PoolSlot{};
+};
+
+struct ThreadPool::JobPool
+{
+    // only touched by the thread owning the slot
+    Job* FreeJobs{ nullptr };
+    // jobs other threads finished, taken over all at once when FreeJobs runs dry
+    std::atomic<Job*> ReturnedJobs{ nullptr };
+    std::vector<std::unique_ptr<Job[]>> Blocks;
+};
+
+struct alignas(64) ThreadPool::Worker
+{
+    WorkStealingDeque<Job, kDequeCapacity> Jobs;
+    JobPool Pool;
+
+    std::atomic<u64> ExecutedJobs{ 0 };
+    std::atomic<u64> StolenJobs{ 0 };
+    std::atomic<u64> FailedSteals{ 0 };
+    std::atomic<u64> Sleeps{ 0 };
+};
+
+thread_local const ThreadPool* ThreadPool::_currentPool{ nullptr };
+thread_local u32 ThreadPool::_currentWorkerIndex{ ThreadPool::NotAWorker };
+
+bool JobCounter::IsDone() const
+{
+    return _pendingJobs.load(std::memory_order_acquire) == 0;
+}
+
+ThreadPool::ThreadPool(const u32 workerCount, const bool isPinned, const ThreadPoolHooks& hooks)
+    : _workerCount{ workerCount },
+    _hooks{ hooks }
+{
+    const auto hardwareThreads = std::max(std::thread::hardware_concurrency(), 1u);
+
+    // slots exist before any worker can look at them
+    for (u32 i = 0; i <= workerCount; i++)
+    {
+        _workers.push_back(std::make_unique<Worker>());
+    }
+
+    _threads.reserve(workerCount);
+    for (u32 i = 0; i < workerCount; i++)
+    {
+        _threads.emplace_back([this, i, isPinned, hardwareThreads]()
+        {
+            PROFILE_THREAD("Worker " + std::to_string(i));
+            _currentPool = this;
+            _currentWorkerIndex = i;
+            if (isPinned)
+            {
+                PinCurrentThread((i + 1) % hardwareThreads);
+            }
+            WorkerLoop(i);
+        });
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard lock(_sleepMutex);
+        _running.store(false);
+    }
+    _sleepCondition.notify_all();
+
+    for (auto& thread : _threads)
+    {
+        thread.join();
+    }
+}
+
+void ThreadPool::Submit(std::function<void()> job, JobCounter* counter)
+{
+    if (counter != nullptr)
+    {
+        counter->_pendingJobs.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    const auto slot = CurrentSlot();
+    if (slot == WorkerCount())
+    {
+        std::lock_guard lock(_sharedMutex);
+        auto pooledJob = AllocateJob(slot);
+        pooledJob->Work = std::move(job);
+        pooledJob->Counter = counter;
+        _sharedJobs.push_back(pooledJob);
+        _sharedJobCount.fetch_add(1, std::memory_order_relaxed);
+    }
+    else
+    {
+        auto pooledJob = AllocateJob(slot);
+        pooledJob->Work = std::move(job);
+        pooledJob->Counter = counter;
+        if (!_workers[slot]->Jobs.TryPush(pooledJob))
+        {
+            std::lock_guard lock(_sharedMutex);
+            _sharedJobs.push_back(pooledJob);
+            _sharedJobCount.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    NotifyQueued();
+}
+
+void ThreadPool::Wait(JobCounter& counter)
+{
+    const auto slot = CurrentSlot();
+    while (!counter.IsDone())
+    {
+        if (const auto job = FindJob(slot))
+        {
+            Execute(slot, job);
+        }
+        else
+        {
+            std::this_thread::yield();
+        }
+    }
+}
+
+void ThreadPool::ParallelFor(const u32 count, const u32 chunkSize, const std::function<void(u32 begin, u32 end)>& body)
+{
+    if (count == 0)
+    {
+        return;
+    }
+
+    const auto chunkCount = (count + chunkSize - 1) / chunkSize;
+    if (chunkCount == 1 || _workerCount == 0)
+    {
+        body(0, count);
+        return;
+    }
+
+    std::atomic<u32> nextChunk{ 0 };
+    JobCounter helpers;
+
+    const auto runChunks = [&]()
+    {
+        for (auto chunk = nextChunk.fetch_add(1); chunk < chunkCount; chunk = nextChunk.fetch_add(1))
+        {
+            const auto begin = chunk * chunkSize;
+            body(begin, std::min(begin + chunkSize, count));
+        }
+    };
+
+    // the calling thread works on chunks as well, so one helper less is enough
+    const auto helperCount = std::min(WorkerCount(), chunkCount - 1);
+    for (u32 i = 0; i < helperCount; i++)
+    {
+        Submit([&runChunks]() { runChunks(); }, &helpers);
+    }
+
+    runChunks();
+
+    // helpers still reference the counters on this stack frame until they are done
+    Wait(helpers);
+}
+
+void ThreadPool::ParallelFor(const u32 count, const std::function<void(u32 begin, u32 end)>& body)
+{
+    const auto chunkSize = std::max(count / ((WorkerCount() + 1) * kChunksPerThread), 1u);
+    ParallelFor(count, chunkSize, body);
+}
+
+u32 ThreadPool::WorkerCount() const
+{
+    return _workerCount;
+}
+
+WorkerStatistics ThreadPool::Statistics(const u32 workerIndex) const
+{
+    const auto& worker = *_workers[workerIndex];
+
+    WorkerStatistics statistics;
+    statistics.ExecutedJobs = worker.ExecutedJobs.load(std::memory_order_relaxed);
+    statistics.StolenJobs = worker.StolenJobs.load(std::memory_order_relaxed);
+    statistics.FailedSteals = worker.FailedSteals.load(std::memory_order_relaxed);
+    statistics.Sleeps = worker.Sleeps.load(std::memory_order_relaxed);
+    return statistics;
+}
+
+u32 ThreadPool::CurrentWorkerIndex()
+{
+    return _currentWorkerIndex;
+}
+
+u32 ThreadPool::DefaultWorkerCount()
+{
+    // leave one hardware thread for the main/render thread
+    const auto hardwareThreads = std::thread::hardware_concurrency();
+    return hardwareThreads > 1 ? hardwareThreads - 1 : 1;
+}
+
+void ThreadPool::PinCurrentThread(const u32 hardwareThread)
+{
+#if defined(__linux__)
+    cpu_set_t cpuSet;
+    CPU_ZERO(&cpuSet);
+    CPU_SET(hardwareThread, &cpuSet);
+    if (pthread_setaffinity_np(pthread_self(), sizeof(cpuSet), &cpuSet) != 0)
+    {
+        std::cerr << "ThreadPool: Unable to pin a worker to hardware thread " << hardwareThread << '\n';
+    }
+#elif defined(_WIN32)
+    if (hardwareThread >= 64 || SetThreadAffinityMask(GetCurrentThread(), DWORD_PTR{ 1 } << hardwareThread) == 0)
+    {
+        std::cerr << "ThreadPool: Unable to pin a worker to hardware thread " << hardwareThread << '\n';
+    }
+#else
+    std::clog << "ThreadPool: Pinning workers is not supported on this platform, hardware thread " << hardwareThread << " ignored\n";
+#endif
+}
+
+void ThreadPool::WorkerLoop(const u32 workerIndex)
+{
+    auto& worker = *_workers[workerIndex];
+    u32 idleRounds = 0;
+
+    while (true)
+    {
+        if (const auto job = FindJob(workerIndex))
+        {
+            idleRounds = 0;
+            Execute(workerIndex, job);
+            continue;
+        }
+
+        // nothing is left anywhere this worker can see, which is all that still has to run
+        if (!_running.load())
+        {
+            return;
+        }
+
+        if (++idleRounds < kIdleRoundsBeforeSleep)
+        {
+            std::this_thread::yield();
+            continue;
+        }
+        idleRounds = 0;
+
+        worker.Sleeps.fetch_add(1, std::memory_order_relaxed);
+        if (_hooks.OnSleep != nullptr)
+        {
+            _hooks.OnSleep(workerIndex);
+        }
+        {
+            // counted as sleeping before checking for work, a submit either sees the sleeper or is seen by it
+            std::unique_lock lock(_sleepMutex);
+            _sleepingWorkers.fetch_add(1);
+            _sleepCondition.wait(lock, [this]() { return !_running.load() || _queuedJobs.load() > 0; });
+            _sleepingWorkers.fetch_sub(1);
+        }
+        if (_hooks.OnWake != nullptr)
+        {
+            _hooks.OnWake(workerIndex);
+        }
+    }
+}
+
+u32 ThreadPool::CurrentSlot() const
+{
+    return _currentPool == this ? _currentWorkerIndex : WorkerCount();
+}
+
+ThreadPool::Job* ThreadPool::AllocateJob(const u32 slot)
+{
+    // the shared slot is only used while holding _sharedMutex
+    auto& pool = _workers[slot]->Pool;
+    if (pool.FreeJobs == nullptr)
+    {
+        pool.FreeJobs = pool.ReturnedJobs.exchange(nullptr, std::memory_order_acquire);
+    }
+
+    if (pool.FreeJobs == nullptr)
+    {
+        auto block = std::make_unique<Job[]>(kJobsPerBlock);
+        for (u32 i = 0; i < kJobsPerBlock; i++)
+        {
+            block[i].PoolSlot = slot;
+            block[i].Next = i + 1 < kJobsPerBlock ? &block[i + 1] : nullptr;
+        }
+        pool.FreeJobs = block.get();
+        pool.Blocks.push_back(std::move(block));
+    }
+
+    const auto job = pool.FreeJobs;
+    pool.FreeJobs = job->Next;
+    return job;
+}
+
+void ThreadPool::FreeJob(Job* job)
+{
+    auto& pool = _workers[job->PoolSlot]->Pool;
+    if (job->PoolSlot != WorkerCount() && job->PoolSlot == CurrentSlot())
+    {
+        job->Next = pool.FreeJobs;
+        pool.FreeJobs = job;
+        return;
+    }
+
+    // any number of threads push, only the owner takes the whole list, so there is no ABA to worry about
+    auto head = pool.ReturnedJobs.load(std::memory_order_relaxed);
+    do
+    {
+        job->Next = head;
+    } while (!pool.ReturnedJobs.compare_exchange_weak(head, job, std::memory_order_release, std::memory_order_relaxed));
+}
+
+void ThreadPool::NotifyQueued()
+{
+    _queuedJobs.fetch_add(1);
+    if (_sleepingWorkers.load() != 0)
+    {
+        std::lock_guard lock(_sleepMutex);
+        _sleepCondition.notify_one();
+    }
+}
+
+ThreadPool::Job* ThreadPool::FindJob(const u32 slot)
+{
+    Job* job = nullptr;
+    if (slot < WorkerCount())
+    {
+        job = _workers[slot]->Jobs.TryPop();
+    }
+
+    if (job == nullptr && _sharedJobCount.load(std::memory_order_relaxed) != 0)
+    {
+        std::lock_guard lock(_sharedMutex);
+        if (!_sharedJobs.empty())
+        {
+            job = _sharedJobs.front();
+            _sharedJobs.pop_front();
+            _sharedJobCount.fetch_sub(1, std::memory_order_relaxed);
+        }
+    }
+
+    if (job == nullptr)
+    {
+        job = Steal(slot);
+    }
+
+    if (job != nullptr)
+    {
+        _queuedJobs.fetch_sub(1, std::memory_order_relaxed);
+    }
+    return job;
+}
+
+ThreadPool::Job* ThreadPool::Steal(const u32 slot)
+{
+    const auto workerCount = WorkerCount();
+    if (workerCount == 0)
+    {
+        return nullptr;
+    }
+
+    // xorshift, starting at a random victim keeps thieves from all queueing up on worker 0
+    thread_local u32 randomState = static_cast<u32>(std::hash<std::thread::id>{}(std::this_thread::get_id())) | 1u;
+    randomState ^= randomState << 13;
+    randomState ^= randomState >> 17;
+    randomState ^= randomState << 5;
+
+    auto& thief = *_workers[slot];
+    const auto firstVictim = randomState % workerCount;
+    for (u32 i = 0; i < workerCount; i++)
+    {
+        const auto victim = (firstVictim + i) % workerCount;
+        if (victim == slot)
+        {
+            continue;
+        }
+
+        if (const auto job = _workers[victim]->Jobs.TrySteal())
+        {
+            thief.StolenJobs.fetch_add(1, std::memory_order_relaxed);
+            return job;
+        }
+    }
+
+    thief.FailedSteals.fetch_add(1, std::memory_order_relaxed);
+    return nullptr;
+}
+
+void ThreadPool::Execute(const u32 slot, Job* job)
+{
+    const auto isWorker = slot < WorkerCount();
+    if (isWorker && _hooks.OnJobBegin != nullptr)
+    {
+        _hooks.OnJobBegin(slot);
+    }
+
+    {
+        PROFILE_SCOPE("ThreadPool::Job");
+        job->Work();
+    }
+
+    if (isWorker && _hooks.OnJobEnd != nullptr)
+    {
+        _hooks.OnJobEnd(slot);
+    }
+    _workers[slot]->ExecutedJobs.fetch_add(1, std::memory_order_relaxed);
+
+    // the counter may be destroyed as soon as it drops to zero, the job is recycled before that
+    const auto counter = job->Counter;
+    job->Work = nullptr;
+    FreeJob(job);
+    if (counter != nullptr)
+    {
+        counter->_pendingJobs.fetch_sub(1, std::memory_order_release);
+    }
+}
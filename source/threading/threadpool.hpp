@@ -0,0 +1,127 @@
+#pragma once
+
+#include "types.hpp"
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Jobs submitted against a counter raise it, finishing them lowers it again.
+// ThreadPool::Wait returns once it is back at zero
+class JobCounter final
+{
+public:
+    JobCounter() = default;
+
+    JobCounter(const JobCounter&) = delete;
+    JobCounter& operator=(const JobCounter&) = delete;
+
+    [[nodiscard]] bool IsDone() const;
+
+private:
+    friend class ThreadPool;
+
+    std::atomic<u32> _pendingJobs{ 0 };
+};
+
+// called on the worker they report on, never on threads outside the pool. Keep them cheap
+struct ThreadPoolHooks
+{
+    void (*OnJobBegin)(u32 workerIndex){ nullptr };
+    void (*OnJobEnd)(u32 workerIndex){ nullptr };
+    void (*OnSleep)(u32 workerIndex){ nullptr };
+    void (*OnWake)(u32 workerIndex){ nullptr };
+};
+
+struct WorkerStatistics
+{
+    u64 ExecutedJobs{};
+    // jobs taken from the deque of another worker
+    u64 StolenJobs{};
+    u64 FailedSteals{};
+    u64 Sleeps{};
+};
+
+// Every worker owns a Chase-Lev deque. Jobs submitted on a worker go into its own deque and are popped
+// newest first, idle workers steal the oldest job of a random other worker. Jobs submitted from other
+// threads go through one shared queue. Job storage comes from per worker pools and is recycled,
+// a job returned by another thread goes back to the pool it came from
+class ThreadPool final
+{
+public:
+    // pinned, worker i stays on hardware thread i + 1, the first one is left to the main/render thread
+    explicit ThreadPool(const u32 workerCount, const bool isPinned = false, const ThreadPoolHooks& hooks = {});
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    void Submit(std::function<void()> job, JobCounter* counter = nullptr);
+
+    // runs other jobs on the calling thread until counter drops to zero, so waiting inside a job cannot
+    // starve the pool
+    void Wait(JobCounter& counter);
+
+    // splits [0, count) into chunks of chunkSize and runs them on the workers and the calling thread,
+    // returns once every chunk has been processed
+    void ParallelFor(const u32 count, const u32 chunkSize, const std::function<void(u32 begin, u32 end)>& body);
+    // picks a chunk size giving every thread a few chunks to balance uneven ones with
+    void ParallelFor(const u32 count, const std::function<void(u32 begin, u32 end)>& body);
+
+    [[nodiscard]] u32 WorkerCount() const;
+    // workerIndex WorkerCount() reports the jobs threads outside the pool ran while waiting.
+    // A snapshot taken while the pool runs may be a little behind
+    [[nodiscard]] WorkerStatistics Statistics(const u32 workerIndex) const;
+
+    // index of the worker running the caller in [0, WorkerCount()), NotAWorker on other threads.
+    // Lets jobs pick per worker storage without locking
+    static constexpr u32 NotAWorker = ~0u;
+    [[nodiscard]] static u32 CurrentWorkerIndex();
+
+    [[nodiscard]] static u32 DefaultWorkerCount();
+
+private:
+    struct Job;
+    struct JobPool;
+    struct Worker;
+
+    void WorkerLoop(const u32 workerIndex);
+    static void PinCurrentThread(const u32 hardwareThread);
+
+    // worker slot of the calling thread in this pool, WorkerCount() for threads outside of it
+    [[nodiscard]] u32 CurrentSlot() const;
+    [[nodiscard]] Job* AllocateJob(const u32 slot);
+    void FreeJob(Job* job);
+    void NotifyQueued();
+    [[nodiscard]] Job* FindJob(const u32 slot);
+    [[nodiscard]] Job* Steal(const u32 slot);
+    void Execute(const u32 slot, Job* job);
+
+    // one per worker and a last one shared by all other threads
+    std::vector<std::unique_ptr<Worker>> _workers;
+    std::vector<std::thread> _threads;
+    // fixed before the first worker starts, _threads is still growing while they do
+    u32 _workerCount;
+    ThreadPoolHooks _hooks;
+
+    // jobs from threads outside the pool and from workers whose deque is full. The mutex also guards
+    // the job pool of the shared slot
+    std::mutex _sharedMutex;
+    std::deque<Job*> _sharedJobs;
+    std::atomic<u32> _sharedJobCount{ 0 };
+
+    // jobs pushed and not yet taken, it dips below zero while a push has not been counted yet
+    std::atomic<s32> _queuedJobs{ 0 };
+    std::atomic<u32> _sleepingWorkers{ 0 };
+    std::atomic<bool> _running{ true };
+    std::mutex _sleepMutex;
+    std::condition_variable _sleepCondition;
+
+    static thread_local const ThreadPool* _currentPool;
+    static thread_local u32 _currentWorkerIndex;
+};
@@ -0,0 +1,89 @@
+#pragma once
+
+#include "types.hpp"
+
+#include <array>
+#include <atomic>
+
+// Bounded Chase-Lev deque (Le, Pop, Cohen, Zappa Nardelli, "Correct and Efficient Work-Stealing for
+// Weak Memory Models"). The owning thread pushes and pops at the bottom, newest first, which keeps
+// what it just spawned warm in its cache. Any other thread steals the oldest item from the top
+template <typename T, u32 Capacity>
+class WorkStealingDeque final
+{
+public:
+    static_assert(Capacity != 0 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+    // owner only, false when the deque is full
+    bool TryPush(T* item)
+    {
+        const auto bottom = _bottom.load(std::memory_order_relaxed);
+        const auto top = _top.load(std::memory_order_acquire);
+        if (bottom - top >= static_cast<s64>(Capacity))
+        {
+            return false;
+        }
+
+        _items[bottom & (Capacity - 1)].store(item, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        _bottom.store(bottom + 1, std::memory_order_relaxed);
+        return true;
+    }
+
+    // owner only, nullptr when the deque is empty or a thief took the last item
+    T* TryPop()
+    {
+        const auto bottom = _bottom.load(std::memory_order_relaxed) - 1;
+        _bottom.store(bottom, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        auto top = _top.load(std::memory_order_relaxed);
+
+        if (top > bottom)
+        {
+            _bottom.store(bottom + 1, std::memory_order_relaxed);
+            return nullptr;
+        }
+
+        auto item = _items[bottom & (Capacity - 1)].load(std::memory_order_relaxed);
+        if (top == bottom)
+        {
+            // the last item, owner and thieves race for it on top
+            if (!_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+            {
+                item = nullptr;
+            }
+            _bottom.store(bottom + 1, std::memory_order_relaxed);
+        }
+        return item;
+    }
+
+    // any thread, nullptr when the deque is empty or another thread won the race for the item
+    T* TrySteal()
+    {
+        auto top = _top.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        const auto bottom = _bottom.load(std::memory_order_acquire);
+        if (top >= bottom)
+        {
+            return nullptr;
+        }
+
+        const auto item = _items[top & (Capacity - 1)].load(std::memory_order_relaxed);
+        if (!_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+        {
+            return nullptr;
+        }
+        return item;
+    }
+
+    // a hint only, the deque can change right after
+    [[nodiscard]] bool IsEmpty() const
+    {
+        return _top.load(std::memory_order_relaxed) >= _bottom.load(std::memory_order_relaxed);
+    }
+
+private:
+    alignas(64) std::atomic<s64> _top{ 0 };
+    alignas(64) std::atomic<s64> _bottom{ 0 };
+    alignas(64) std::array<std::atomic<T*>, Capacity> _items{};
+};